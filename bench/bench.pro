@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Benchmark of the CPU transform engine
+#
+#-------------------------------------------------
+
+QT       -= gui
+
+CONFIG += c++11 console thread
+CONFIG -= app_bundle
+
+TARGET = transformbench
+TEMPLATE = app
+
+DESTDIR = ../bin
+OBJECTS_DIR = ../build/bench/obj
+
+INCLUDEPATH += ../glm ../src
+
+SOURCES += transformbench.cpp \
+    ../src/threadpool.cpp \
+    ../src/transformengine.cpp
+
+HEADERS += ../src/threadpool.h \
+    ../src/transformengine.h
@@ -0,0 +1,106 @@
+#include "transformengine.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// Compares the transform engine against the scalar glm::vec4 loop SceneWidget used to run per vertex
+
+namespace
+{
+    // Runs func until at least minTime has passed and returns the average time per run in milliseconds
+    template <typename Func>
+    double timeRuns(Func func)
+    {
+        using Clock = std::chrono::steady_clock;
+        const std::chrono::milliseconds minTime(500);
+
+        func(); // warm up
+
+        unsigned runs = 0;
+        const Clock::time_point start = Clock::now();
+        Clock::duration elapsed;
+
+        do
+        {
+            func();
+            ++runs;
+            elapsed = Clock::now() - start;
+        } while (elapsed < minTime);
+
+        return std::chrono::duration<double, std::milli>(elapsed).count() / runs;
+    }
+}
+
+int main()
+{
+    const glm::mat4 modelMatrix = glm::rotate(glm::mat4(), glm::radians(30.0f), glm::vec3(0, 1, 0));
+    const glm::mat4 viewMatrix = glm::lookAt(glm::vec3(10.0f, 10.0f, 10.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    const glm::mat4 projectionMatrix = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 30.0f);
+
+    std::cout << "Kernel: " << TransformEngine::kernelName(TransformEngine::kernel()) <<
+                 "\nThreads: " << ThreadPool::instance().numOfThreads() << '\n' << std::endl;
+
+    std::cout << std::setw(10) << "vertices" <<
+                 std::setw(14) << "glm (ms)" <<
+                 std::setw(14) << "engine (ms)" <<
+                 std::setw(10) << "speedup" <<
+                 std::setw(14) << "max error" << std::endl;
+
+    const std::size_t counts[] = { 24, 10000, 1000000, 10000000 };
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+    for (std::size_t count : counts)
+    {
+        std::vector<glm::vec3> positions(count);
+        for (glm::vec3 &position : positions)
+            position = glm::vec3(distribution(random), distribution(random), distribution(random));
+
+        // Scalar reference: the loop from SceneWidget::updateNdcData()
+        std::vector<glm::vec3> reference(count);
+        const double scalarTime = timeRuns([&]()
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                glm::vec4 vert4(positions[i], 1.0f);
+                vert4 = projectionMatrix * viewMatrix * modelMatrix * vert4;
+                vert4 /= vert4.w;
+                reference[i] = glm::vec3(vert4.x, vert4.y, vert4.z);
+            }
+        });
+
+        // Transform engine with a premultiplied matrix
+        const PositionBuffer in = PositionBuffer::fromPositions(positions);
+        PositionBuffer out;
+        const double engineTime = timeRuns([&]()
+        {
+            const glm::mat4 mvp = projectionMatrix * viewMatrix * modelMatrix;
+            TransformEngine::transformToNdc(mvp, in, out);
+        });
+
+        float maxError = 0.0f;
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            maxError = std::max(maxError, std::abs(out.x[i] - reference[i].x));
+            maxError = std::max(maxError, std::abs(out.y[i] - reference[i].y));
+            maxError = std::max(maxError, std::abs(out.z[i] - reference[i].z));
+        }
+
+        std::cout << std::setw(10) << count <<
+                     std::setw(14) << std::fixed << std::setprecision(4) << scalarTime <<
+                     std::setw(14) << engineTime <<
+                     std::setw(9) << std::setprecision(1) << scalarTime / engineTime << 'x' <<
+                     std::setw(14) << std::scientific << std::setprecision(2) << maxError << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+    }
+
+    return EXIT_SUCCESS;
+}
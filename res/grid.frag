@@ -0,0 +1,70 @@
+#version 330
+
+// Per-frame camera data, shared by all programs (see SceneRenderer::CameraBlock)
+layout(std140) uniform Camera
+{
+	mat4 transformChains[4];
+	int selectedInstance;
+	int numOfVisibleInstances;
+};
+
+// Index of the transform chain of the grid
+uniform int transformChain;
+
+in vec4 nearPoint;
+in vec4 farPoint;
+
+out vec4 fragColor;
+
+// Distance from the camera over which the grid fades into the background
+const float fadeStart = 20.0f;
+const float fadeEnd = 80.0f;
+
+void main()
+{
+	vec3 near = nearPoint.xyz / nearPoint.w;
+	vec3 far = farPoint.xyz / farPoint.w;
+
+	// Where the ray through this pixel hits the y = 0 plane
+	float t = -near.y / (far.y - near.y);
+	vec3 position = near + t * (far - near);
+
+	// Size of a pixel on the plane, taken before any fragment is discarded
+	vec2 coord = position.xz;
+	vec2 pixelSize = fwidth(coord);
+
+	// Plane behind the camera or beyond the far plane
+	if (t < 0.0f || t > 1.0f)
+		discard;
+
+	// Distance in pixels to the nearest line, anti-aliased over one pixel
+	vec2 lineDistance = abs(fract(coord - 0.5f) - 0.5f) / pixelSize;
+	float alpha = 1.0f - min(min(lineDistance.x, lineDistance.y), 1.0f);
+	vec3 color = vec3(0.75f);
+
+	// Lines only a few pixels apart fade out instead of turning into moire
+	alpha *= 1.0f - smoothstep(0.25f, 0.5f, max(pixelSize.x, pixelSize.y));
+
+	// x-axis in red, z-axis in blue, like the line grid
+	vec2 axis = 1.0f - min(abs(coord) / pixelSize, 1.0f);
+	if (axis.y > 0.0f)
+	{
+		color = vec3(1.0f, 0.0f, 0.0f);
+		alpha = max(alpha, axis.y);
+	}
+	if (axis.x > 0.0f)
+	{
+		color = vec3(0.0f, 0.0f, 1.0f);
+		alpha = max(alpha, axis.x);
+	}
+
+	alpha *= 1.0f - smoothstep(fadeStart, fadeEnd, length(position - near));
+	if (alpha <= 0.0f)
+		discard;
+
+	// Depth of the point on the plane, so the grid hides behind meshes
+	vec4 clip = transformChains[transformChain] * vec4(position, 1.0f);
+	gl_FragDepth = 0.5f * clip.z / clip.w + 0.5f;
+
+	fragColor = vec4(color, alpha);
+}
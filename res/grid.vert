@@ -0,0 +1,28 @@
+#version 330
+
+// Per-frame camera data, shared by all programs (see SceneRenderer::CameraBlock)
+layout(std140) uniform Camera
+{
+	mat4 transformChains[4];
+	int selectedInstance;
+	int numOfVisibleInstances;
+};
+
+// Index of the transform chain of the grid
+uniform int transformChain;
+
+// Ends of the ray through the pixel on the near and far plane, divided by w in the fragment shader
+out vec4 nearPoint;
+out vec4 farPoint;
+
+void main()
+{
+	// One clockwise triangle covering the whole screen, without any vertex data
+	vec2 corner = vec2(gl_VertexID & 2, (gl_VertexID << 1) & 2) * 2.0f - 1.0f;
+
+	mat4 inverseChain = inverse(transformChains[transformChain]);
+	nearPoint = inverseChain * vec4(corner, -1.0f, 1.0f);
+	farPoint = inverseChain * vec4(corner, 1.0f, 1.0f);
+
+	gl_Position = vec4(corner, 0.0f, 1.0f);
+}
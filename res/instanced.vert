@@ -0,0 +1,28 @@
+#version 330
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in mat4 instanceModelMatrix;
+
+smooth out vec3 outColor;
+
+// Per-frame camera data, shared by all programs (see SceneRenderer::CameraBlock)
+layout(std140) uniform Camera
+{
+	mat4 transformChains[4];
+	int selectedInstance;
+	int numOfVisibleInstances;
+};
+
+void main()
+{
+	// The instances chain stops short of the model matrix
+	gl_Position = transformChains[3] * (instanceModelMatrix * vec4(position, 1.0f));
+
+	// Fade all instances except the selected one
+	outColor = gl_InstanceID == selectedInstance ? color : mix(color, vec3(1.0f), 0.5f);
+
+	// Tint the culled instances, which are stored after the visible ones
+	if (gl_InstanceID >= numOfVisibleInstances)
+		outColor = mix(outColor, vec3(1.0f, 0.0f, 0.0f), 0.6f);
+}
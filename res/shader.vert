@@ -5,10 +5,22 @@ layout(location = 1) in vec3 color;
 
 smooth out vec3 outColor;
 
-uniform mat4 mvpMatrix;
+// Per-frame camera data, shared by all programs (see SceneRenderer::CameraBlock)
+layout(std140) uniform Camera
+{
+	mat4 transformChains[4];
+	int selectedInstance;
+	int numOfVisibleInstances;
+};
+
+// Index of the transform chain used by the current draw call
+uniform int transformChain;
+
+// Mesh outside the frustum of the view camera, still drawn in world & view space
+uniform bool culled;
 
 void main()
 {
-	gl_Position = mvpMatrix * vec4(position, 1.0f);
-	outColor = color;
+	gl_Position = transformChains[transformChain] * vec4(position, 1.0f);
+	outColor = culled ? mix(color, vec3(1.0f, 0.0f, 0.0f), 0.6f) : color;
 }
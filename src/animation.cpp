@@ -0,0 +1,100 @@
+#include "animation.h"
+#include "sceneoptions.h"
+#include <QCommandLineParser>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    SceneParameters mix(const SceneParameters &a, const SceneParameters &b, float t)
+    {
+        SceneParameters result;
+
+        result.modelScale = glm::mix(a.modelScale, b.modelScale, t);
+        result.modelRotate = glm::mix(a.modelRotate, b.modelRotate, t);
+        result.modelTranslate = glm::mix(a.modelTranslate, b.modelTranslate, t);
+
+        result.viewPosition = glm::mix(a.viewPosition, b.viewPosition, t);
+        result.viewTarget = glm::mix(a.viewTarget, b.viewTarget, t);
+        result.viewUpVec = glm::mix(a.viewUpVec, b.viewUpVec, t);
+
+        result.projectionNear = glm::mix(a.projectionNear, b.projectionNear, t);
+        result.projectionFar = glm::mix(a.projectionFar, b.projectionFar, t);
+        result.projectionFov = glm::mix(a.projectionFov, b.projectionFov, t);
+
+        return result;
+    }
+}
+
+Animation Animation::load(const std::string &path, const SceneParameters &initial)
+{
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QFile::ReadOnly | QFile::Text))
+        throw std::runtime_error("Could not open file: " + path);
+
+    Animation animation;
+    SceneParameters parameters = initial;
+
+    QTextStream stream(&file);
+    while (!stream.atEnd())
+    {
+        const QString line = stream.readLine().simplified();
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        QStringList args = line.split(' ');
+
+        bool ok;
+        const double time = args.takeFirst().toDouble(&ok);
+        if (!ok || time < 0.0)
+            throw std::runtime_error("Invalid keyframe time in line: " + line.toStdString());
+
+        QCommandLineParser parser;
+        SceneOptions::addOptions(parser);
+
+        if (!parser.parse(QStringList("keyframe") + args))
+            throw std::runtime_error("Invalid keyframe line " + line.toStdString() + ": " + parser.errorText().toStdString());
+
+        SceneOptions::applyParameters(parser, parameters);
+        animation.addKeyframe(time, parameters);
+    }
+
+    if (animation.isEmpty())
+        throw std::runtime_error("Animation has no keyframes: " + path);
+
+    return animation;
+}
+
+void Animation::addKeyframe(double time, const SceneParameters &parameters)
+{
+    const Keyframe keyframe = { time, parameters };
+
+    // After keyframes with the same time, so a jump can be made with two of them
+    auto pos = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+                                [](double t, const Keyframe &k) { return t < k.time; });
+    m_keyframes.insert(pos, keyframe);
+}
+
+SceneParameters Animation::sample(double time) const
+{
+    if (m_keyframes.empty())
+        throw std::runtime_error("Cannot sample an empty animation");
+
+    if (time <= m_keyframes.front().time)
+        return m_keyframes.front().parameters;
+
+    if (time >= m_keyframes.back().time)
+        return m_keyframes.back().parameters;
+
+    // First keyframe after time, the previous one is at or before it
+    auto next = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), time,
+                                 [](double t, const Keyframe &k) { return t < k.time; });
+    auto prev = next - 1;
+
+    const float t = static_cast<float>((time - prev->time) / (next->time - prev->time));
+    return mix(prev->parameters, next->parameters, t);
+}
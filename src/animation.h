@@ -0,0 +1,36 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <string>
+#include <vector>
+#include "sceneparameters.h"
+
+// Keyframe timeline of the scene parameters, sampled with linear interpolation
+class Animation
+{
+public:
+    struct Keyframe
+    {
+        double time;
+        SceneParameters parameters;
+    };
+
+    // Every line holds a time in seconds followed by scene options, e.g.
+    // "2.5 --model-rotate 0,90,0 --fov 60". Parameters a keyframe does not
+    // set keep their value from the previous one, starting from initial.
+    static Animation load(const std::string &path, const SceneParameters &initial);
+
+    // Keyframes are kept sorted on time
+    void addKeyframe(double time, const SceneParameters &parameters);
+
+    bool isEmpty() const { return m_keyframes.empty(); }
+    double duration() const { return m_keyframes.empty() ? 0.0 : m_keyframes.back().time; }
+
+    // Parameters at the given time, clamped to the first and last keyframe
+    SceneParameters sample(double time) const;
+
+private:
+    std::vector<Keyframe> m_keyframes;
+};
+
+#endif // ANIMATION_H
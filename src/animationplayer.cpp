@@ -0,0 +1,61 @@
+#include "animationplayer.h"
+#include <cmath>
+
+namespace
+{
+    // A frame this close to the end is the last one, so a step that divides the
+    // duration ends on the last keyframe despite rounding
+    const double endTolerance = 1e-6;
+}
+
+AnimationPlayer::AnimationPlayer(QObject *parent) :
+    QObject(parent), m_fixedStep(0.0), m_frame(0), m_looping(true), m_playing(false)
+{
+
+}
+
+void AnimationPlayer::setAnimation(const Animation &animation)
+{
+    stop();
+    m_animation = animation;
+}
+
+void AnimationPlayer::play()
+{
+    if (m_animation.isEmpty())
+        return;
+
+    m_playing = true;
+    m_frame = 0;
+    m_clock.start();
+    advance();
+}
+
+void AnimationPlayer::stop()
+{
+    m_playing = false;
+}
+
+void AnimationPlayer::advance()
+{
+    if (!m_playing)
+        return;
+
+    // Frame index times the step keeps fixed-step playback free of accumulated rounding
+    double time = m_fixedStep > 0.0 ? m_frame * m_fixedStep : m_clock.nsecsElapsed() / 1.0e9;
+    ++m_frame;
+
+    const double duration = m_animation.duration();
+    if (!m_looping)
+    {
+        if (time >= duration - endTolerance)
+        {
+            time = duration;
+            m_playing = false;
+        }
+    }
+    else if (duration > 0.0)
+        time = std::fmod(time, duration);
+
+    emit parametersChanged(m_animation.sample(time));
+}
@@ -0,0 +1,49 @@
+#ifndef ANIMATIONPLAYER_H
+#define ANIMATIONPLAYER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include "animation.h"
+#include "sceneparameters.h"
+
+// Plays an animation. advance() is meant to be called once per presented frame
+// (e.g. on frameSwapped), so playback follows the display refresh and every
+// frame sets all parameters in one go. Headless rendering calls it once per
+// rendered frame instead, with a fixed step.
+class AnimationPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AnimationPlayer(QObject *parent = 0);
+
+    void setAnimation(const Animation &animation);
+
+    // Advance a fixed time per frame instead of following the clock, 0 for the clock.
+    // Makes playback deterministic, independent of the actual frame rate.
+    void setFixedStep(double seconds) { m_fixedStep = seconds; }
+
+    // Without looping, playback stops after a frame that shows the end of the animation
+    void setLooping(bool looping) { m_looping = looping; }
+
+    bool isPlaying() const { return m_playing; }
+
+public slots:
+    void play();
+    void stop();
+    void advance();
+
+signals:
+    // Parameters of the next frame, which has to be drawn to keep playing
+    void parametersChanged(const SceneParameters &parameters);
+
+private:
+    Animation m_animation;
+    QElapsedTimer m_clock;
+    double m_fixedStep;
+    unsigned long m_frame;
+    bool m_looping;
+    bool m_playing;
+};
+
+#endif // ANIMATIONPLAYER_H
@@ -0,0 +1,174 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cmath>
+
+Aabb Aabb::ofUnitCube(const glm::mat4 &matrix)
+{
+    // Every column of the matrix adds its absolute value to the half extent
+    const glm::vec3 centre(matrix[3]);
+    const glm::vec3 extent = glm::abs(glm::vec3(matrix[0])) + glm::abs(glm::vec3(matrix[1])) + glm::abs(glm::vec3(matrix[2]));
+
+    Aabb box;
+    box.min = centre - extent;
+    box.max = centre + extent;
+    return box;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4 &viewProjection)
+{
+    // Rows of the matrix, glm stores columns
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; ++i)
+        rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+    // -w <= x, y, z <= w
+    Frustum frustum;
+    for (int i = 0; i < 3; ++i)
+    {
+        frustum.planes[2 * i] = rows[3] + rows[i];
+        frustum.planes[2 * i + 1] = rows[3] - rows[i];
+    }
+
+    return frustum;
+}
+
+Frustum::Containment Frustum::classify(const Aabb &box) const
+{
+    const glm::vec3 centre = (box.min + box.max) * 0.5f;
+    const glm::vec3 extent = (box.max - box.min) * 0.5f;
+
+    Containment result = Inside;
+    for (const glm::vec4 &plane : planes)
+    {
+        const glm::vec3 normal(plane);
+        const float distance = glm::dot(normal, centre) + plane.w;
+        const float radius = glm::dot(glm::abs(normal), extent);
+
+        if (distance + radius < 0.0f)
+            return Outside;
+        if (distance - radius < 0.0f)
+            result = Intersecting;
+    }
+
+    return result;
+}
+
+void Bvh::build(const std::vector<Aabb> &boxes)
+{
+    m_boxes = boxes;
+    m_items.resize(boxes.size());
+    m_leafOf.resize(boxes.size());
+    m_nodes.clear();
+
+    for (std::uint32_t i = 0; i < m_items.size(); ++i)
+        m_items[i] = i;
+
+    if (!m_boxes.empty())
+    {
+        m_nodes.reserve(2 * (m_boxes.size() / maxLeafItems + 1));
+        buildNode(0, static_cast<std::uint32_t>(m_items.size()), noNode);
+    }
+}
+
+std::uint32_t Bvh::buildNode(std::uint32_t first, std::uint32_t count, std::uint32_t parent)
+{
+    const std::uint32_t index = static_cast<std::uint32_t>(m_nodes.size());
+    m_nodes.push_back(Node());
+
+    Aabb bounds = m_boxes[m_items[first]];
+    Aabb centres = { (bounds.min + bounds.max) * 0.5f, (bounds.min + bounds.max) * 0.5f };
+    for (std::uint32_t i = first + 1; i < first + count; ++i)
+    {
+        const Aabb &box = m_boxes[m_items[i]];
+        const glm::vec3 centre = (box.min + box.max) * 0.5f;
+        bounds.extend(box);
+        centres.extend({ centre, centre });
+    }
+
+    Node node = { bounds, parent, noNode, first, count };
+
+    if (count <= maxLeafItems)
+    {
+        for (std::uint32_t i = first; i < first + count; ++i)
+            m_leafOf[m_items[i]] = index;
+    }
+    else
+    {
+        // Split at the median along the axis where the centres lie furthest apart
+        const glm::vec3 spread = centres.max - centres.min;
+        const int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+        const std::uint32_t half = count / 2;
+
+        std::nth_element(m_items.begin() + first, m_items.begin() + first + half, m_items.begin() + first + count,
+                         [this, axis](std::uint32_t a, std::uint32_t b) {
+            return m_boxes[a].min[axis] + m_boxes[a].max[axis] < m_boxes[b].min[axis] + m_boxes[b].max[axis];
+        });
+
+        buildNode(first, half, index);
+        node.right = buildNode(first + half, count - half, index);
+    }
+
+    m_nodes[index] = node;
+    return index;
+}
+
+void Bvh::refit(std::uint32_t item, const Aabb &box)
+{
+    m_boxes[item] = box;
+
+    // Recalculate the leaf, then every node above it
+    std::uint32_t index = m_leafOf[item];
+    Node &leaf = m_nodes[index];
+    leaf.bounds = m_boxes[m_items[leaf.first]];
+    for (std::uint32_t i = leaf.first + 1; i < leaf.first + leaf.count; ++i)
+        leaf.bounds.extend(m_boxes[m_items[i]]);
+
+    for (index = leaf.parent; index != noNode; index = m_nodes[index].parent)
+    {
+        Node &node = m_nodes[index];
+        node.bounds = m_nodes[index + 1].bounds;
+        node.bounds.extend(m_nodes[node.right].bounds);
+    }
+}
+
+void Bvh::cull(const Frustum &frustum, std::vector<std::uint32_t> &visible, std::vector<std::uint32_t> &culled) const
+{
+    if (m_nodes.empty())
+        return;
+
+    std::vector<std::uint32_t> stack(1, 0);
+    while (!stack.empty())
+    {
+        const std::uint32_t index = stack.back();
+        stack.pop_back();
+
+        const Node &node = m_nodes[index];
+        const auto begin = m_items.begin() + node.first;
+        const auto end = begin + node.count;
+
+        switch (frustum.classify(node.bounds))
+        {
+        // Whole subtrees at once
+        case Frustum::Outside:
+            culled.insert(culled.end(), begin, end);
+            break;
+
+        case Frustum::Inside:
+            visible.insert(visible.end(), begin, end);
+            break;
+
+        case Frustum::Intersecting:
+            if (node.right != noNode)
+            {
+                stack.push_back(node.right);
+                stack.push_back(index + 1);
+            }
+            else
+            {
+                for (auto it = begin; it != end; ++it)
+                    (frustum.classify(m_boxes[*it]) == Frustum::Outside ? culled : visible).push_back(*it);
+            }
+            break;
+        }
+    }
+}
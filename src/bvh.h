@@ -0,0 +1,75 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Axis aligned bounding box
+struct Aabb
+{
+    glm::vec3 min;
+    glm::vec3 max;
+
+    // Bounds of the [-1, 1] cube, where all meshes fit, after a transformation
+    static Aabb ofUnitCube(const glm::mat4 &matrix);
+
+    void extend(const Aabb &other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+};
+
+// Planes of a view frustum, with the normals pointing inwards
+struct Frustum
+{
+    enum Containment
+    {
+        Outside, Intersecting, Inside
+    };
+
+    glm::vec4 planes[6];
+
+    // Planes of the clip volume of a projection * view matrix
+    static Frustum fromMatrix(const glm::mat4 &viewProjection);
+
+    Containment classify(const Aabb &box) const;
+};
+
+// Bounding volume hierarchy over a set of boxes, for culling them against a
+// frustum without testing every box. Built once for a set of boxes; a moving
+// box only refits the nodes from its leaf up to the root.
+class Bvh
+{
+public:
+    void build(const std::vector<Aabb> &boxes);
+
+    // Replaces the box of one item, the tree keeps its shape
+    void refit(std::uint32_t item, const Aabb &box);
+
+    // Appends the items in or touching the frustum to visible, all others to culled
+    void cull(const Frustum &frustum, std::vector<std::uint32_t> &visible, std::vector<std::uint32_t> &culled) const;
+
+    std::size_t numOfItems() const { return m_boxes.size(); }
+
+private:
+    static constexpr std::uint32_t maxLeafItems = 4;
+    static constexpr std::uint32_t noNode = UINT32_MAX;
+
+    // The items of every subtree are contiguous in m_items. The left child of an
+    // inner node directly follows it, leaves have no right child.
+    struct Node
+    {
+        Aabb bounds;
+        std::uint32_t parent;
+        std::uint32_t right;
+        std::uint32_t first;
+        std::uint32_t count;
+    };
+
+    std::uint32_t buildNode(std::uint32_t first, std::uint32_t count, std::uint32_t parent);
+
+    std::vector<Aabb> m_boxes;
+    std::vector<std::uint32_t> m_items;
+    std::vector<std::uint32_t> m_leafOf;
+    std::vector<Node> m_nodes;
+};
+
+#endif // BVH_H
@@ -0,0 +1,54 @@
+#ifndef CACHEDVALUE_H
+#define CACHEDVALUE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+struct CacheStats
+{
+    std::uint64_t hits;
+    std::uint64_t misses;
+
+    CacheStats &operator+=(const CacheStats &other) { hits += other.hits; misses += other.misses; return *this; }
+};
+
+// Value derived from a fixed number of inputs. Every input is identified by a
+// version counter that its owner bumps whenever it changes, so the value only
+// needs recomputing when a version differs from the last computation.
+template <typename T, std::size_t NumOfInputs>
+class CachedValue
+{
+public:
+    typedef std::array<std::uint64_t, NumOfInputs> Versions;
+
+    CachedValue() : m_valid(false), m_stats{0, 0} {}
+
+    // Calls compute() if any input changed, returns true if it did
+    template <typename Compute>
+    bool update(const Versions &versions, Compute compute)
+    {
+        if (m_valid && versions == m_versions)
+        {
+            ++m_stats.hits;
+            return false;
+        }
+
+        m_value = compute();
+        m_versions = versions;
+        m_valid = true;
+        ++m_stats.misses;
+        return true;
+    }
+
+    const T &value() const { return m_value; }
+    const CacheStats &stats() const { return m_stats; }
+
+private:
+    T m_value;
+    Versions m_versions;
+    bool m_valid;
+    CacheStats m_stats;
+};
+
+#endif // CACHEDVALUE_H
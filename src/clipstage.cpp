@@ -0,0 +1,284 @@
+#include "clipstage.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CLIP_HAS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // -w <= x <= w, -w <= y <= w and -w <= z <= w, in this order
+    const int numOfPlanes = 6;
+
+    // Every plane adds at most one vertex to a convex polygon
+    const int maxPolygonSize = 3 + numOfPlanes;
+
+    // Marks the indices of created vertices until the chunks are merged
+    const std::uint32_t createdFlag = 1u << 31;
+
+    // Smaller meshes are clipped on the calling thread
+    const std::size_t minChunkTriangles = 8192;
+
+    struct ClipVertex
+    {
+        glm::vec4 position;
+        std::uint32_t index;  // In the mesh, createdFlag for a created vertex
+    };
+
+    // Positive inside the plane
+    float planeDistance(const glm::vec4 &v, int plane)
+    {
+        const float coordinate = v[plane / 2];
+        return plane % 2 == 0 ? v.w + coordinate : v.w - coordinate;
+    }
+
+    void classifyScalar(const float *x, const float *y, const float *z, const float *w, std::uint32_t *outcodes,
+                        std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            outcodes[i] = (w[i] + x[i] < 0.0f ? 1u << 0 : 0u) | (w[i] - x[i] < 0.0f ? 1u << 1 : 0u) |
+                          (w[i] + y[i] < 0.0f ? 1u << 2 : 0u) | (w[i] - y[i] < 0.0f ? 1u << 3 : 0u) |
+                          (w[i] + z[i] < 0.0f ? 1u << 4 : 0u) | (w[i] - z[i] < 0.0f ? 1u << 5 : 0u);
+        }
+    }
+
+#ifdef CLIP_HAS_SSE
+    void classifySse(const float *x, const float *y, const float *z, const float *w, std::uint32_t *outcodes,
+                     std::size_t begin, std::size_t end)
+    {
+        const __m128 zero = _mm_setzero_ps();
+
+        std::size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 vx = _mm_loadu_ps(x + i);
+            const __m128 vy = _mm_loadu_ps(y + i);
+            const __m128 vz = _mm_loadu_ps(z + i);
+            const __m128 vw = _mm_loadu_ps(w + i);
+
+            const __m128 distances[numOfPlanes] = {
+                _mm_add_ps(vw, vx), _mm_sub_ps(vw, vx),
+                _mm_add_ps(vw, vy), _mm_sub_ps(vw, vy),
+                _mm_add_ps(vw, vz), _mm_sub_ps(vw, vz)
+            };
+
+            __m128i codes = _mm_setzero_si128();
+            for (int plane = 0; plane < numOfPlanes; ++plane)
+            {
+                const __m128i outside = _mm_castps_si128(_mm_cmplt_ps(distances[plane], zero));
+                codes = _mm_or_si128(codes, _mm_and_si128(outside, _mm_set1_epi32(1 << plane)));
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(outcodes + i), codes);
+        }
+
+        classifyScalar(x, y, z, w, outcodes, i, end);
+    }
+#endif
+
+    // Sutherland-Hodgman against one plane, returns the number of vertices left
+    int clipPolygon(const ClipVertex *in, int count, int plane, ClipVertex *out)
+    {
+        int numOfOut = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            const ClipVertex &current = in[i];
+            const ClipVertex &next = in[(i + 1) % count];
+            const float currentDistance = planeDistance(current.position, plane);
+            const float nextDistance = planeDistance(next.position, plane);
+            const bool currentInside = currentDistance >= 0.0f;
+
+            if (currentInside)
+                out[numOfOut++] = current;
+
+            // Always interpolated from the inside vertex, so the neighbour sharing the edge gets the same point
+            if (currentInside != (nextDistance >= 0.0f))
+            {
+                const ClipVertex &inside = currentInside ? current : next;
+                const ClipVertex &outside = currentInside ? next : current;
+                const float insideDistance = currentInside ? currentDistance : nextDistance;
+                const float outsideDistance = currentInside ? nextDistance : currentDistance;
+                const float t = insideDistance / (insideDistance - outsideDistance);
+
+                out[numOfOut].position = inside.position + t * (outside.position - inside.position);
+                out[numOfOut].index = createdFlag;
+                ++numOfOut;
+            }
+        }
+
+        return numOfOut;
+    }
+}
+
+ClipStage::ClipStage() : m_numOfMeshVertices(0), m_versions(), m_valid(false)
+{
+
+}
+
+bool ClipStage::update(const Versions &versions, const Mesh &mesh, const glm::mat4 &mvp, const glm::vec3 &createdColour)
+{
+    if (m_valid && versions == m_versions)
+        return false;
+
+    // Another mesh or level of detail
+    if (!m_valid || versions[0] != m_versions[0] || versions[1] != m_versions[1])
+        m_positions = PositionBuffer::fromPositions(mesh.positions);
+
+    transformVertices(mesh, mvp);
+
+    // At most a chunk per thread
+    ThreadPool &pool = ThreadPool::instance();
+    const std::size_t numOfTriangles = mesh.numOfTriangles();
+    const std::size_t numOfChunks = std::max<std::size_t>(std::min<std::size_t>(pool.numOfThreads(), numOfTriangles / minChunkTriangles), 1);
+    if (m_chunks.size() < numOfChunks)
+        m_chunks.resize(numOfChunks);
+
+    pool.parallelFor(numOfChunks, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t chunk = begin; chunk < end; ++chunk)
+            clipTriangles(mesh, createdColour, numOfTriangles * chunk / numOfChunks, numOfTriangles * (chunk + 1) / numOfChunks, m_chunks[chunk]);
+    });
+
+    // Merge the chunks, with the created vertices after those of the mesh
+    std::size_t numOfIndices = 0;
+    std::size_t numOfCreated = 0;
+    for (std::size_t chunk = 0; chunk < numOfChunks; ++chunk)
+    {
+        m_chunks[chunk].firstIndex = numOfIndices;
+        m_chunks[chunk].firstCreated = numOfCreated;
+        numOfIndices += m_chunks[chunk].indices.size();
+        numOfCreated += m_chunks[chunk].created.size();
+    }
+
+    m_vertices.resize(m_numOfMeshVertices + numOfCreated);
+    m_indices.resize(numOfIndices);
+
+    pool.parallelFor(numOfChunks, 1, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t chunk = begin; chunk < end; ++chunk)
+        {
+            const Chunk &c = m_chunks[chunk];
+            const std::uint32_t createdBase = static_cast<std::uint32_t>(m_numOfMeshVertices + c.firstCreated);
+            std::copy(c.created.begin(), c.created.end(), m_vertices.begin() + createdBase);
+
+            std::uint32_t *out = m_indices.data() + c.firstIndex;
+            for (std::size_t i = 0; i < c.indices.size(); ++i)
+            {
+                const std::uint32_t index = c.indices[i];
+                out[i] = index & createdFlag ? createdBase + (index & ~createdFlag) : index;
+            }
+        }
+    });
+
+    m_versions = versions;
+    m_valid = true;
+    return true;
+}
+
+void ClipStage::transformVertices(const Mesh &mesh, const glm::mat4 &mvp)
+{
+    const std::size_t count = m_positions.size();
+    m_numOfMeshVertices = count;
+    m_clip.resize(count);
+    m_clipW.resize(count);
+    m_outcodes.resize(count);
+    m_vertices.resize(count);
+
+    const TransformEngine::Kernel kernel = TransformEngine::kernel();
+
+    ThreadPool::instance().parallelFor(count, TransformEngine::parallelThreshold / 2, [&](std::size_t begin, std::size_t end)
+    {
+        TransformEngine::transform(kernel, mvp, m_positions.x.data() + begin, m_positions.y.data() + begin, m_positions.z.data() + begin,
+                                   m_clip.x.data() + begin, m_clip.y.data() + begin, m_clip.z.data() + begin, m_clipW.data() + begin, end - begin);
+
+#ifdef CLIP_HAS_SSE
+        classifySse(m_clip.x.data(), m_clip.y.data(), m_clip.z.data(), m_clipW.data(), m_outcodes.data(), begin, end);
+#else
+        classifyScalar(m_clip.x.data(), m_clip.y.data(), m_clip.z.data(), m_clipW.data(), m_outcodes.data(), begin, end);
+#endif
+
+        // Meaningless for vertices outside the view volume, but no triangle uses those
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float w = m_clipW[i];
+            m_vertices[i].position = glm::vec3(m_clip.x[i] / w, m_clip.y[i] / w, m_clip.z[i] / w);
+            m_vertices[i].colour = mesh.colours[i];
+        }
+    });
+}
+
+void ClipStage::clipTriangles(const Mesh &mesh, const glm::vec3 &createdColour, std::size_t begin, std::size_t end, Chunk &chunk) const
+{
+    chunk.indices.clear();
+    chunk.created.clear();
+
+    ClipVertex buffers[2][maxPolygonSize];
+
+    for (std::size_t triangle = begin; triangle < end; ++triangle)
+    {
+        const std::uint32_t *indices = mesh.indices.data() + 3 * triangle;
+        const std::uint32_t codes[3] = { m_outcodes[indices[0]], m_outcodes[indices[1]], m_outcodes[indices[2]] };
+
+        // All vertices outside the same plane
+        if (codes[0] & codes[1] & codes[2])
+            continue;
+
+        // All vertices inside every plane
+        const std::uint32_t crossed = codes[0] | codes[1] | codes[2];
+        if (!crossed)
+        {
+            chunk.indices.insert(chunk.indices.end(), indices, indices + 3);
+            continue;
+        }
+
+        ClipVertex *polygon = buffers[0];
+        ClipVertex *clipped = buffers[1];
+        for (int i = 0; i < 3; ++i)
+        {
+            const std::uint32_t index = indices[i];
+            polygon[i].position = glm::vec4(m_clip.x[index], m_clip.y[index], m_clip.z[index], m_clipW[index]);
+            polygon[i].index = index;
+        }
+
+        // Only against the planes that one of the vertices is outside of
+        int count = 3;
+        for (int plane = 0; plane < numOfPlanes && count >= 3; ++plane)
+        {
+            if (crossed & (1u << plane))
+            {
+                count = clipPolygon(polygon, count, plane, clipped);
+                std::swap(polygon, clipped);
+            }
+        }
+
+        if (count < 3)
+            continue;
+
+        // Number the created vertices, then split the polygon into a fan with the same winding
+        std::uint32_t polygonIndices[maxPolygonSize];
+        for (int i = 0; i < count; ++i)
+        {
+            if (polygon[i].index != createdFlag)
+            {
+                polygonIndices[i] = polygon[i].index;
+                continue;
+            }
+
+            const glm::vec4 &position = polygon[i].position;
+            polygonIndices[i] = createdFlag | static_cast<std::uint32_t>(chunk.created.size());
+            chunk.created.push_back({glm::vec3(position) / position.w, createdColour});
+        }
+
+        for (int i = 1; i + 1 < count; ++i)
+        {
+            chunk.indices.push_back(polygonIndices[0]);
+            chunk.indices.push_back(polygonIndices[i]);
+            chunk.indices.push_back(polygonIndices[i + 1]);
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef CLIPSTAGE_H
+#define CLIPSTAGE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "geometryarena.h"
+#include "transformengine.h"
+
+// Clips the triangles of a mesh against the six planes of the view volume in homogeneous
+// clip space, before the division by w, like the clipper of the GPU. Vertices behind the
+// camera would otherwise end up mirrored in front of it in NDC.
+//
+// Every vertex is transformed and classified once, with SIMD, by the planes it is outside of.
+// From those codes a triangle inside all planes keeps its vertices and one outside any plane
+// is dropped; only the triangles crossing a plane are clipped, with Sutherland-Hodgman on
+// fixed-size polygons. The triangles are split into chunks on the thread pool that write
+// into buffers kept between updates, so nothing is allocated per triangle.
+class ClipStage
+{
+public:
+    // Versions of the mesh, its level of detail and the model, view and projection matrices
+    typedef std::array<std::uint64_t, 5> Versions;
+
+    ClipStage();
+
+    // Reclips when one of the versions differs from the last update, returns true if it did.
+    // Vertices created by clipping get the given colour.
+    bool update(const Versions &versions, const Mesh &mesh, const glm::mat4 &mvp, const glm::vec3 &createdColour);
+
+    // Vertices in NDC: those of the mesh in the same order, followed by the ones created by
+    // clipping. Mesh vertices outside the view volume are kept, but no triangle uses them.
+    const std::vector<GeometryArena::Vertex> &vertices() const { return m_vertices; }
+    const std::vector<std::uint32_t> &indices() const { return m_indices; }
+
+    std::size_t numOfCreatedVertices() const { return m_vertices.size() - m_numOfMeshVertices; }
+
+private:
+    // Output of one range of triangles, created vertices are numbered within the chunk
+    struct Chunk
+    {
+        std::vector<std::uint32_t> indices;
+        std::vector<GeometryArena::Vertex> created;
+
+        // Where the chunk goes in the merged output
+        std::size_t firstIndex;
+        std::size_t firstCreated;
+    };
+
+    void transformVertices(const Mesh &mesh, const glm::mat4 &mvp);
+    void clipTriangles(const Mesh &mesh, const glm::vec3 &createdColour, std::size_t begin, std::size_t end, Chunk &chunk) const;
+
+    // Mesh positions as structure of arrays, converted when the mesh changes
+    PositionBuffer m_positions;
+
+    // Clip space coordinates and the planes every vertex is outside of, a bit per plane
+    PositionBuffer m_clip;
+    std::vector<float> m_clipW;
+    std::vector<std::uint32_t> m_outcodes;
+
+    std::vector<Chunk> m_chunks;
+    std::vector<GeometryArena::Vertex> m_vertices;
+    std::vector<std::uint32_t> m_indices;
+    std::size_t m_numOfMeshVertices;
+
+    Versions m_versions;
+    bool m_valid;
+};
+
+#endif // CLIPSTAGE_H
@@ -18,6 +18,15 @@ void FloatSlider::onValueChanged(int)
     emit stringValueChanged(getStringRep());
 }
 
+void FloatSlider::showScaledValue(float scaledValue)
+{
+    const bool blocked = blockSignals(true);
+    setValue(qRound(scaledValue / m_scale));
+    blockSignals(blocked);
+
+    emit stringValueChanged(getStringRep());
+}
+
 QString FloatSlider::getStringRep() const
 {
     QLocale sysLocale = QLocale::system();
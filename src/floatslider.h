@@ -22,6 +22,9 @@ public:
     void setSuffix(const QString &suffix) { m_suffix = suffix; }
 
     float scaledValue() const { return value() * scale(); }
+
+    // Moves to the nearest step without emitting scaledValueChanged(), the string still follows
+    void showScaledValue(float scaledValue);
     QString getStringRep() const;
 
     void init(float scale = 0.1f, int precision = 1, const QString &suffix = "");
@@ -0,0 +1,187 @@
+#include "frameprofiler.h"
+#include <QOpenGLContext>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+TimingSeries::TimingSeries(std::size_t capacity) :
+    m_capacity(capacity), m_next(0)
+{
+    m_samples.reserve(capacity);
+}
+
+void TimingSeries::add(double ms)
+{
+    if (m_samples.size() < m_capacity)
+        m_samples.push_back(ms);
+    else
+        m_samples[m_next] = ms;
+
+    m_next = (m_next + 1) % m_capacity;
+}
+
+TimingSeries::Summary TimingSeries::summary() const
+{
+    Summary summary = { 0.0, 0.0, 0.0, m_samples.size() };
+    if (m_samples.empty())
+        return summary;
+
+    std::vector<double> sorted(m_samples);
+
+    summary.min = *std::min_element(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (double sample : sorted)
+        sum += sample;
+    summary.avg = sum / sorted.size();
+
+    const std::size_t p99Index = static_cast<std::size_t>(std::ceil(0.99 * sorted.size())) - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + p99Index, sorted.end());
+    summary.p99 = sorted[p99Index];
+
+    return summary;
+}
+
+FrameProfiler::FrameProfiler() :
+    m_gl(nullptr), m_nextQuery(0), m_gpuFrameActive(false)
+{
+    std::fill(m_queries, m_queries + numOfQueries, 0);
+    std::fill(m_queryPending, m_queryPending + numOfQueries, false);
+}
+
+const char *FrameProfiler::sectionName(Section section)
+{
+    switch (section)
+    {
+    case FrameCpu:
+        return "frame_cpu";
+    case RecomputeCpu:
+        return "recompute_cpu";
+    case MvpMatrixCpu:
+        return "mvp_matrix_cpu";
+    case FrustumDataCpu:
+        return "frustum_data_cpu";
+    case MeshDataCpu:
+        return "mesh_data_cpu";
+    case CullingCpu:
+        return "culling_cpu";
+    case ClipCpu:
+        return "clip_cpu";
+    case RasterCpu:
+        return "raster_cpu";
+    case FrameGpu:
+        return "frame_gpu";
+    default:
+        return "unknown";
+    }
+}
+
+void FrameProfiler::initializeGpuTimers(QOpenGLFunctions_3_3_Core *gl)
+{
+    // Timer queries are core since OpenGL 3.3
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QSurfaceFormat format = context->format();
+    const bool supported = format.majorVersion() > 3 || (format.majorVersion() == 3 && format.minorVersion() >= 3) ||
+                           context->hasExtension("GL_ARB_timer_query") || context->hasExtension("GL_EXT_timer_query");
+
+    if (!supported)
+        return;
+
+    m_gl = gl;
+    m_gl->glGenQueries(numOfQueries, m_queries);
+}
+
+void FrameProfiler::beginGpuFrame()
+{
+    if (!m_gl)
+        return;
+
+    collectGpuResults(false);
+
+    // All queries still in flight: skip this frame rather than wait
+    if (m_queryPending[m_nextQuery])
+        return;
+
+    m_gl->glBeginQuery(GL_TIME_ELAPSED, m_queries[m_nextQuery]);
+    m_gpuFrameActive = true;
+}
+
+void FrameProfiler::endGpuFrame()
+{
+    if (!m_gpuFrameActive)
+        return;
+
+    m_gl->glEndQuery(GL_TIME_ELAPSED);
+    m_queryPending[m_nextQuery] = true;
+    m_nextQuery = (m_nextQuery + 1) % numOfQueries;
+    m_gpuFrameActive = false;
+}
+
+void FrameProfiler::collectGpuResults(bool wait)
+{
+    if (!m_gl)
+        return;
+
+    // Oldest query first, results become available in submission order
+    for (std::size_t i = 0; i < numOfQueries; ++i)
+    {
+        const std::size_t query = (m_nextQuery + i) % numOfQueries;
+        if (!m_queryPending[query])
+            continue;
+
+        if (!wait)
+        {
+            GLuint available = 0;
+            m_gl->glGetQueryObjectuiv(m_queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return;
+        }
+
+        // Nanoseconds, 32 bits is plenty for a single frame
+        GLuint elapsed = 0;
+        m_gl->glGetQueryObjectuiv(m_queries[query], GL_QUERY_RESULT, &elapsed);
+        addSample(FrameGpu, elapsed / 1.0e6);
+        m_queryPending[query] = false;
+    }
+}
+
+QString FrameProfiler::summaryText() const
+{
+    QString text = "Tijden in ms (min / gem / p99)";
+
+    for (int section = 0; section < NumOfSections; ++section)
+    {
+        const TimingSeries::Summary s = summary(static_cast<Section>(section));
+        if (!s.samples)
+            continue;
+
+        text += QString("\n%1: %2 / %3 / %4").arg(sectionName(static_cast<Section>(section)))
+                                             .arg(s.min, 0, 'f', 3).arg(s.avg, 0, 'f', 3).arg(s.p99, 0, 'f', 3);
+    }
+
+    return text;
+}
+
+void FrameProfiler::writeCsv(const std::string &path) const
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Could not open file: " + path);
+
+    file << "section,samples,min_ms,avg_ms,p99_ms\n";
+
+    for (int section = 0; section < NumOfSections; ++section)
+    {
+        const TimingSeries::Summary s = summary(static_cast<Section>(section));
+        file << sectionName(static_cast<Section>(section)) << ',' << s.samples << ',' <<
+                s.min << ',' << s.avg << ',' << s.p99 << '\n';
+    }
+
+    if (!file)
+        throw std::runtime_error("Could not write file: " + path);
+}
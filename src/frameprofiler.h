@@ -0,0 +1,93 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QElapsedTimer>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QString>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Rolling window of timing samples in milliseconds
+class TimingSeries
+{
+public:
+    explicit TimingSeries(std::size_t capacity = 240);
+
+    struct Summary
+    {
+        double min;
+        double avg;
+        double p99;
+        std::size_t samples;
+    };
+
+    void add(double ms);
+    Summary summary() const;
+
+private:
+    std::vector<double> m_samples;
+    std::size_t m_capacity;
+    std::size_t m_next;
+};
+
+// Collects CPU timings of the render and recompute paths, and the GPU time of
+// every frame through GL_TIME_ELAPSED queries. The queries are kept in a ring
+// and read back a few frames later, so reading them never stalls the pipeline.
+// Samples can be added on the render thread while the UI reads the summaries.
+class FrameProfiler
+{
+public:
+    enum Section
+    {
+        FrameCpu, RecomputeCpu, MvpMatrixCpu, FrustumDataCpu, MeshDataCpu, CullingCpu, ClipCpu, RasterCpu, FrameGpu, NumOfSections
+    };
+
+    FrameProfiler();
+
+    static const char *sectionName(Section section);
+
+    // Needs a current context; GPU timing stays off if timer queries are not supported
+    void initializeGpuTimers(QOpenGLFunctions_3_3_Core *gl);
+
+    void beginGpuFrame();
+    void endGpuFrame();
+
+    // Reads back finished queries, optionally waiting for all outstanding ones
+    void collectGpuResults(bool wait);
+
+    void addSample(Section section, double ms) { std::lock_guard<std::mutex> lock(m_mutex); m_series[section].add(ms); }
+    TimingSeries::Summary summary(Section section) const { std::lock_guard<std::mutex> lock(m_mutex); return m_series[section].summary(); }
+
+    QString summaryText() const;
+    void writeCsv(const std::string &path) const;
+
+private:
+    static constexpr std::size_t numOfQueries = 4;
+
+    TimingSeries m_series[NumOfSections];
+    mutable std::mutex m_mutex;
+
+    QOpenGLFunctions_3_3_Core *m_gl;
+    GLuint m_queries[numOfQueries];
+    bool m_queryPending[numOfQueries];
+    std::size_t m_nextQuery;
+    bool m_gpuFrameActive;
+};
+
+// Adds the time between construction and destruction to a section
+class ScopedCpuTimer
+{
+public:
+    ScopedCpuTimer(FrameProfiler &profiler, FrameProfiler::Section section) :
+        m_profiler(profiler), m_section(section) { m_timer.start(); }
+    ~ScopedCpuTimer() { m_profiler.addSample(m_section, m_timer.nsecsElapsed() / 1.0e6); }
+
+private:
+    FrameProfiler &m_profiler;
+    FrameProfiler::Section m_section;
+    QElapsedTimer m_timer;
+};
+
+#endif // FRAMEPROFILER_H
@@ -0,0 +1,105 @@
+#include "framescheduler.h"
+#include "processinfo.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Frames are released this much before their interval is over
+    const double vsyncSlackMs = 2.0;
+}
+
+FrameScheduler::FrameScheduler(QObject *parent) :
+    QObject(parent), m_maxFps(0.0), m_state(State::Idle), m_requestedWhileDue(false), m_frames(0), m_requests(0),
+    m_cpuSecondsAtStats(ProcessInfo::cpuSeconds())
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &FrameScheduler::onTimeout);
+
+    m_sinceStats.start();
+}
+
+void FrameScheduler::setMaxFps(double fps)
+{
+    m_maxFps = fps > 0.0 ? fps : 0.0;
+}
+
+FrameScheduler::Stats FrameScheduler::takeStats()
+{
+    const double seconds = std::max(m_sinceStats.restart() / 1.0e3, 1.0e-3);
+    const double cpuSeconds = ProcessInfo::cpuSeconds();
+
+    Stats stats;
+    stats.frames = m_frames;
+    stats.requests = m_requests;
+    stats.fps = m_frames / seconds;
+    stats.cpuPercent = 100.0 * (cpuSeconds - m_cpuSecondsAtStats) / seconds;
+
+    m_frames = 0;
+    m_requests = 0;
+    m_cpuSecondsAtStats = cpuSeconds;
+    return stats;
+}
+
+void FrameScheduler::requestFrame()
+{
+    ++m_requests;
+
+    switch (m_state)
+    {
+    case State::Idle:
+        schedule();
+        break;
+
+    case State::Waiting:
+        // Merged into the frame already waiting
+        break;
+
+    case State::Due:
+        m_requestedWhileDue = true;
+        break;
+    }
+}
+
+void FrameScheduler::frameRendered()
+{
+    // Also called for repaints nobody asked for, e.g. after a resize
+    ++m_frames;
+    m_sinceLastFrame.start();
+    m_state = State::Idle;
+
+    // Requests that came in while the frame was drawn get a frame of their own
+    if (m_requestedWhileDue)
+    {
+        m_requestedWhileDue = false;
+        schedule();
+    }
+}
+
+void FrameScheduler::onTimeout()
+{
+    m_state = State::Due;
+    emit frameDue();
+}
+
+void FrameScheduler::schedule()
+{
+    // The interval is counted from the last swap, which already waited for a vblank. Released
+    // a full interval later, a frame at the display rate would just miss the next vblank and
+    // wait for the one after it, halving the frame rate; the slack keeps it ahead of that.
+    qint64 wait = 0;
+    if (m_maxFps > 0.0 && m_sinceLastFrame.isValid())
+        wait = static_cast<qint64>(std::floor(1.0e3 / m_maxFps - vsyncSlackMs)) - m_sinceLastFrame.elapsed();
+
+    if (wait > 0)
+    {
+        m_state = State::Waiting;
+        m_timer.start(static_cast<int>(wait));
+    }
+    else
+    {
+        m_state = State::Due;
+        emit frameDue();
+    }
+}
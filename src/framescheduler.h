@@ -0,0 +1,68 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+// Decides when the scene is repainted. All requests until the next frame are
+// merged into that frame, frames are at least 1 / maxFps apart, and without
+// requests nothing runs at all: no timers and no repaints.
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FrameScheduler(QObject *parent = 0);
+
+    // 0 leaves the frame rate to the display
+    double maxFps() const { return m_maxFps; }
+    void setMaxFps(double fps);
+
+    // Usage since the previous call
+    struct Stats
+    {
+        unsigned long frames;
+        unsigned long requests;
+        double fps;
+        double cpuPercent; // Of one core, for the whole process
+    };
+
+    Stats takeStats();
+
+public slots:
+    void requestFrame();
+
+    // Call once a frame was presented, e.g. on frameSwapped
+    void frameRendered();
+
+signals:
+    // Time to draw the next frame, e.g. connected to QWidget::update
+    void frameDue();
+
+private slots:
+    void onTimeout();
+
+private:
+    enum class State
+    {
+        Idle, Waiting, Due
+    };
+
+    void schedule();
+
+    QTimer m_timer;
+    QElapsedTimer m_sinceLastFrame;
+    double m_maxFps;
+    State m_state;
+
+    // A request while a frame is due may come after that frame was drawn
+    bool m_requestedWhileDue;
+
+    unsigned long m_frames;
+    unsigned long m_requests;
+    QElapsedTimer m_sinceStats;
+    double m_cpuSecondsAtStats;
+};
+
+#endif // FRAMESCHEDULER_H
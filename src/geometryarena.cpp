@@ -0,0 +1,289 @@
+#include "geometryarena.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+    GLubyte toUnorm8(float value)
+    {
+        return static_cast<GLubyte>(std::lround(glm::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    GLshort toSnorm16(float value)
+    {
+        return static_cast<GLshort>(std::lround(glm::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+}
+
+GeometryArena::GeometryArena(PositionFormat format) :
+    m_gl(nullptr), m_format(format), m_vao(0), m_vertexVbo(0), m_indexVbo(0), m_vertexCapacity(0), m_indexCapacity(0), m_numOfVertices(0), m_numOfIndices(0)
+{
+
+}
+
+void GeometryArena::initialize(QOpenGLFunctions_3_3_Core *gl, GLsizei vertexCapacity, GLsizei indexCapacity)
+{
+    m_gl = gl;
+
+    m_gl->glGenVertexArrays(1, &m_vao);
+    m_gl->glGenBuffers(1, &m_vertexVbo);
+    m_gl->glGenBuffers(1, &m_indexVbo);
+
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_vertexVbo);
+    m_gl->glBufferData(GL_ARRAY_BUFFER, vertexSize(m_format) * vertexCapacity, nullptr, GL_STATIC_DRAW);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexVbo);
+    m_gl->glBufferData(GL_COPY_WRITE_BUFFER, sizeof(std::uint32_t) * indexCapacity, nullptr, GL_STATIC_DRAW);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    m_vertexCapacity = vertexCapacity;
+    m_indexCapacity = indexCapacity;
+
+    setVertexAttribs();
+}
+
+GLsizei GeometryArena::vertexSize(PositionFormat format)
+{
+    // Positions are padded to 4 bytes, followed by 4 colour bytes
+    switch (format)
+    {
+    case PositionFormat::Float:
+        return 3 * sizeof(GLfloat) + 4;
+    case PositionFormat::HalfFloat:
+    case PositionFormat::Snorm16:
+        return 4 * sizeof(GLshort) + 4;
+    default:
+        throw std::runtime_error("Unknown position format");
+    }
+}
+
+void GeometryArena::setPositionFormat(PositionFormat format)
+{
+    if (format == m_format)
+        return;
+
+    m_format = format;
+    clear();
+
+    // Same number of vertices in the new format
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_vertexVbo);
+    m_gl->glBufferData(GL_ARRAY_BUFFER, vertexSize(m_format) * m_vertexCapacity, nullptr, GL_STATIC_DRAW);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    setVertexAttribs();
+}
+
+void GeometryArena::setVertexAttribs()
+{
+    const GLsizei stride = vertexSize(m_format);
+    const GLsizei colourOffset = stride - 4;
+
+    m_gl->glBindVertexArray(m_vao);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_vertexVbo);
+    m_gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexVbo);
+
+    // Position attrib, the shader sees a vec3 in every format
+    m_gl->glEnableVertexAttribArray(0);
+    switch (m_format)
+    {
+    case PositionFormat::Float:
+        m_gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+        break;
+    case PositionFormat::HalfFloat:
+        m_gl->glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, reinterpret_cast<void*>(0));
+        break;
+    case PositionFormat::Snorm16:
+        m_gl->glVertexAttribPointer(0, 3, GL_SHORT, GL_TRUE, stride, reinterpret_cast<void*>(0));
+        break;
+    }
+
+    // Colour attrib
+    m_gl->glEnableVertexAttribArray(1);
+    m_gl->glVertexAttribPointer(1, 3, GL_UNSIGNED_BYTE, GL_TRUE, stride, reinterpret_cast<void*>(colourOffset));
+
+    // Cleanup
+    m_gl->glBindVertexArray(0);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GeometryArena::Range GeometryArena::allocate(const std::vector<Vertex> &vertices, const std::vector<std::uint32_t> &indices)
+{
+    const Range range = allocate(static_cast<GLsizei>(vertices.size()), static_cast<GLsizei>(indices.size()));
+
+    try
+    {
+        return update(range, vertices, indices);
+    }
+    catch (const std::exception &)
+    {
+        // Vertices that do not fit the format, the range is still the last one
+        release(range);
+        throw;
+    }
+}
+
+GeometryArena::Range GeometryArena::allocate(GLsizei numOfVertices, GLsizei numOfIndices)
+{
+    reserve(m_numOfVertices + numOfVertices, m_numOfIndices + numOfIndices);
+
+    const Range range = { m_numOfVertices, numOfVertices, static_cast<GLsizeiptr>(sizeof(std::uint32_t)) * m_numOfIndices, numOfIndices };
+
+    m_numOfVertices += numOfVertices;
+    m_numOfIndices += numOfIndices;
+
+    return range;
+}
+
+void GeometryArena::update(const Range &range, const std::vector<Vertex> &vertices)
+{
+    if (static_cast<GLsizei>(vertices.size()) != range.numOfVertices)
+        throw std::runtime_error("Vertex count does not match the allocated range");
+
+    const std::vector<GLubyte> packed = pack(m_format, vertices);
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, m_vertexVbo);
+    m_gl->glBufferSubData(GL_ARRAY_BUFFER, vertexSize(m_format) * range.baseVertex, packed.size(), packed.data());
+    m_gl->glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GeometryArena::Range GeometryArena::update(const Range &range, const std::vector<Vertex> &vertices, const std::vector<std::uint32_t> &indices)
+{
+    const GLsizei numOfVertices = static_cast<GLsizei>(vertices.size());
+    const GLsizei numOfIndices = static_cast<GLsizei>(indices.size());
+
+    if (numOfVertices > range.numOfVertices || numOfIndices > range.numOfIndices)
+        throw std::runtime_error("Mesh does not fit in the allocated range");
+
+    const Range used = { range.baseVertex, numOfVertices, range.firstIndex, numOfIndices };
+    update(used, vertices);
+
+    // Not bound to the element array binding, that would change the one of whatever VAO is bound
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexVbo);
+    m_gl->glBufferSubData(GL_COPY_WRITE_BUFFER, used.firstIndex, sizeof(std::uint32_t) * indices.size(), indices.data());
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    return used;
+}
+
+std::vector<GLubyte> GeometryArena::pack(PositionFormat format, const std::vector<Vertex> &vertices)
+{
+    const GLsizei stride = vertexSize(format);
+    std::vector<GLubyte> packed(stride * vertices.size());
+
+    for (std::size_t i = 0; i < vertices.size(); ++i)
+    {
+        GLubyte *dst = &packed[stride * i];
+        const glm::vec3 &position = vertices[i].position;
+        const glm::vec3 &colour = vertices[i].colour;
+
+        switch (format)
+        {
+        case PositionFormat::Float:
+            std::memcpy(dst, &position, 3 * sizeof(GLfloat));
+            break;
+
+        case PositionFormat::HalfFloat:
+        {
+            const GLushort halves[] = { glm::packHalf1x16(position.x), glm::packHalf1x16(position.y), glm::packHalf1x16(position.z), 0 };
+            std::memcpy(dst, halves, sizeof halves);
+            break;
+        }
+
+        case PositionFormat::Snorm16:
+        {
+            // Some slack for rounding in the normalization of loaded meshes
+            const float limit = 1.0f + 1e-4f;
+            if (std::abs(position.x) > limit || std::abs(position.y) > limit || std::abs(position.z) > limit)
+                throw std::runtime_error("Snorm16 positions must lie in [-1, 1]");
+
+            const GLshort snorms[] = { toSnorm16(position.x), toSnorm16(position.y), toSnorm16(position.z), 0 };
+            std::memcpy(dst, snorms, sizeof snorms);
+            break;
+        }
+        }
+
+        // Colour bytes in r, g, b, a order regardless of endianness
+        GLubyte *dstColour = dst + stride - 4;
+        dstColour[0] = toUnorm8(colour.x);
+        dstColour[1] = toUnorm8(colour.y);
+        dstColour[2] = toUnorm8(colour.z);
+        dstColour[3] = 255;
+    }
+
+    return packed;
+}
+
+void GeometryArena::release(const Range &range)
+{
+    const bool isLast = range.baseVertex + range.numOfVertices == m_numOfVertices &&
+                        range.firstIndex + static_cast<GLsizeiptr>(sizeof(std::uint32_t)) * range.numOfIndices == static_cast<GLsizeiptr>(sizeof(std::uint32_t)) * m_numOfIndices;
+
+    if (!isLast)
+        return;
+
+    m_numOfVertices -= range.numOfVertices;
+    m_numOfIndices -= range.numOfIndices;
+}
+
+void GeometryArena::clear()
+{
+    m_numOfVertices = 0;
+    m_numOfIndices = 0;
+}
+
+void GeometryArena::draw(GLenum mode, const Range &range)
+{
+    m_gl->glDrawElementsBaseVertex(mode, range.numOfIndices, GL_UNSIGNED_INT, reinterpret_cast<void*>(range.firstIndex), range.baseVertex);
+}
+
+void GeometryArena::drawInstanced(GLenum mode, const Range &range, GLsizei numOfInstances)
+{
+    m_gl->glDrawElementsInstancedBaseVertex(mode, range.numOfIndices, GL_UNSIGNED_INT, reinterpret_cast<void*>(range.firstIndex), numOfInstances, range.baseVertex);
+}
+
+void GeometryArena::reserve(GLsizei numOfVertices, GLsizei numOfIndices)
+{
+    const bool grow = numOfVertices > m_vertexCapacity || numOfIndices > m_indexCapacity;
+
+    // Grow by doubling, so loading meshes one after the other stays linear
+    if (numOfVertices > m_vertexCapacity)
+    {
+        const GLsizei capacity = std::max(numOfVertices, 2 * m_vertexCapacity);
+        m_vertexVbo = resizeBuffer(m_vertexVbo, vertexSize(m_format) * m_numOfVertices, vertexSize(m_format) * capacity);
+        m_vertexCapacity = capacity;
+    }
+
+    if (numOfIndices > m_indexCapacity)
+    {
+        const GLsizei capacity = std::max(numOfIndices, 2 * m_indexCapacity);
+        m_indexVbo = resizeBuffer(m_indexVbo, sizeof(std::uint32_t) * m_numOfIndices, sizeof(std::uint32_t) * capacity);
+        m_indexCapacity = capacity;
+    }
+
+    // The VAO still points at the old buffers
+    if (grow)
+        setVertexAttribs();
+}
+
+GLuint GeometryArena::resizeBuffer(GLuint buffer, GLsizeiptr usedSize, GLsizeiptr newSize)
+{
+    GLuint newBuffer;
+    m_gl->glGenBuffers(1, &newBuffer);
+
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    m_gl->glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW);
+
+    // Copy on the GPU, no read-back needed
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    m_gl->glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, usedSize);
+
+    m_gl->glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    m_gl->glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_gl->glDeleteBuffers(1, &buffer);
+
+    return newBuffer;
+}
@@ -0,0 +1,93 @@
+#ifndef GEOMETRYARENA_H
+#define GEOMETRYARENA_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// All geometry of the scene in one interleaved vertex buffer and one index
+// buffer behind a single VAO. Meshes are suballocated one after the other and
+// drawn with base-vertex draws, so switching between them needs no state changes.
+class GeometryArena
+{
+public:
+    // Vertices as passed in, they are packed into the arena's format
+    struct Vertex
+    {
+        glm::vec3 position;
+        glm::vec3 colour;
+    };
+
+    // Storage of the positions. Colours are always normalized unsigned bytes.
+    // Snorm16 only holds positions in [-1, 1], like meshes from MeshLoader.
+    enum class PositionFormat
+    {
+        Float, HalfFloat, Snorm16
+    };
+
+    // Bytes per vertex in the buffer
+    static GLsizei vertexSize(PositionFormat format);
+
+    // Vertices as they are stored in the buffer, throws when they do not fit the format
+    static std::vector<GLubyte> pack(PositionFormat format, const std::vector<Vertex> &vertices);
+
+    // Part of the arena holding one mesh
+    struct Range
+    {
+        GLint baseVertex;
+        GLsizei numOfVertices;
+        GLsizeiptr firstIndex;
+        GLsizei numOfIndices;
+    };
+
+    explicit GeometryArena(PositionFormat format = PositionFormat::Float);
+
+    // Needs a current context. Position and colour are attribs 0 and 1 of the VAO.
+    void initialize(QOpenGLFunctions_3_3_Core *gl, GLsizei vertexCapacity, GLsizei indexCapacity);
+
+    GLuint vao() const { return m_vao; }
+
+    PositionFormat positionFormat() const { return m_format; }
+
+    // Drops all ranges, as they are stored in the old format
+    void setPositionFormat(PositionFormat format);
+
+    // Appends a mesh, growing the buffers when needed. Indices are relative to its first vertex.
+    Range allocate(const std::vector<Vertex> &vertices, const std::vector<std::uint32_t> &indices);
+
+    // Appends room for meshes of up to this size, written later with update()
+    Range allocate(GLsizei numOfVertices, GLsizei numOfIndices);
+
+    // Overwrites the vertices of a range with as many new ones
+    void update(const Range &range, const std::vector<Vertex> &vertices);
+
+    // Writes a mesh into the start of a range with room for it, returns the part it takes up
+    Range update(const Range &range, const std::vector<Vertex> &vertices, const std::vector<std::uint32_t> &indices);
+
+    // Space is only given back when the range is the last one allocated,
+    // otherwise it stays unused until the arena is cleared
+    void release(const Range &range);
+    void clear();
+
+    // Expect the VAO to be bound
+    void draw(GLenum mode, const Range &range);
+    void drawInstanced(GLenum mode, const Range &range, GLsizei numOfInstances);
+
+private:
+    void reserve(GLsizei numOfVertices, GLsizei numOfIndices);
+    GLuint resizeBuffer(GLuint buffer, GLsizeiptr usedSize, GLsizeiptr newSize);
+    void setVertexAttribs();
+
+    QOpenGLFunctions_3_3_Core *m_gl;
+    PositionFormat m_format;
+    GLuint m_vao;
+    GLuint m_vertexVbo;
+    GLuint m_indexVbo;
+    GLsizei m_vertexCapacity;
+    GLsizei m_indexCapacity;
+    GLsizei m_numOfVertices;
+    GLsizei m_numOfIndices;
+};
+
+#endif // GEOMETRYARENA_H
@@ -1,20 +1,252 @@
 #include "mainwindow.h"
+#include "offscreenrenderer.h"
+#include "sceneoptions.h"
+#include "animation.h"
+#include "animationplayer.h"
+#include "processinfo.h"
 #include <QApplication>
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QMessageBox>
 #include <QString>
+#include <QStringList>
+#include <QTextStream>
 #include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    void saveFrame(const QImage &image, const QString &path)
+    {
+        if (!image.save(path))
+            throw std::runtime_error("Could not write frame: " + path.toStdString());
+    }
+
+    void writeTimings(const QCommandLineParser &parser, OffscreenRenderer &renderer)
+    {
+        if (!parser.isSet("timings"))
+            return;
+
+        FrameProfiler &profiler = renderer.scene().profiler();
+        profiler.collectGpuResults(true);
+        profiler.writeCsv(parser.value("timings").toStdString());
+    }
+
+    // One frame per line of the sweep file, returns the number of frames
+    int renderSweep(const QCommandLineParser &parser, OffscreenRenderer &renderer, const QString &output)
+    {
+        QFile sweepFile(parser.value("sweep"));
+        if (!sweepFile.open(QFile::ReadOnly | QFile::Text))
+            throw std::runtime_error("Could not open file: " + parser.value("sweep").toStdString());
+
+        QTextStream stream(&sweepFile);
+        int frame = 0;
+
+        while (!stream.atEnd())
+        {
+            const QString line = stream.readLine().simplified();
+            if (line.isEmpty() || line.startsWith("#"))
+                continue;
+
+            QCommandLineParser frameParser;
+            SceneOptions::addOptions(frameParser);
+
+            if (!frameParser.parse(QStringList("frame") + line.split(' ')))
+                throw std::runtime_error("Invalid sweep line " + line.toStdString() + ": " + frameParser.errorText().toStdString());
+
+            SceneOptions::apply(frameParser, renderer.scene());
+            saveFrame(renderer.renderFrame(), output.arg(frame, 6, 10, QChar('0')));
+            ++frame;
+        }
+
+        return frame;
+    }
+
+    // The whole animation once, played with a fixed step so every run gives the same frames
+    int renderAnimation(const QCommandLineParser &parser, OffscreenRenderer &renderer, const QString &output)
+    {
+        bool ok;
+        const double fps = parser.value("fps").toDouble(&ok);
+        if (!ok || fps <= 0.0)
+            throw std::runtime_error("Invalid value for --fps: " + parser.value("fps").toStdString());
+
+        AnimationPlayer player;
+        player.setAnimation(Animation::load(parser.value("animation").toStdString(), renderer.scene().parameters()));
+        player.setFixedStep(1.0 / fps);
+        player.setLooping(false);
+
+        // Frames are rendered outside the signal, so errors do not pass through Qt
+        SceneParameters parameters;
+        bool hasFrame = false;
+        QObject::connect(&player, &AnimationPlayer::parametersChanged, [&](const SceneParameters &next) {
+            parameters = next;
+            hasFrame = true;
+        });
+
+        int frame = 0;
+        for (player.play(); hasFrame; player.advance())
+        {
+            hasFrame = false;
+            renderer.scene().setParameters(parameters);
+            saveFrame(renderer.renderFrame(), output.arg(frame, 6, 10, QChar('0')));
+            ++frame;
+        }
+
+        return frame;
+    }
+
+    // Renders one frame, a sweep or an animation without opening a window
+    int runHeadless(const QCommandLineParser &parser)
+    {
+        const QStringList size = parser.value("size").split('x');
+        if (size.size() != 2 || size.at(0).toInt() <= 0 || size.at(1).toInt() <= 0)
+            throw std::runtime_error("Invalid frame size: " + parser.value("size").toStdString());
+
+        const QString output = parser.value("output");
+        if (output.isEmpty())
+            throw std::runtime_error("Headless mode needs an --output file");
+
+        // The offscreen platform needs an X display for OpenGL, without one only the software backend works
+        SceneRenderer::Backend backend = SceneOptions::parseBackend(parser.value("backend"));
+        if (backend == SceneRenderer::Backend::OpenGL && !parser.isSet("backend") && !OffscreenRenderer::isOpenGLAvailable())
+        {
+            std::clog << "No OpenGL 3.3 context available, rendering with the software backend" << std::endl;
+            backend = SceneRenderer::Backend::Software;
+        }
+
+        OffscreenRenderer renderer(size.at(0).toInt(), size.at(1).toInt(), backend);
+
+        const QStringList positional = parser.positionalArguments();
+        if (!positional.isEmpty())
+            renderer.scene().loadMesh(positional.at(0).toStdString());
+
+        SceneOptions::apply(parser, renderer.scene());
+
+        // Single frame
+        if (!parser.isSet("sweep") && !parser.isSet("animation"))
+        {
+            saveFrame(renderer.renderFrame(), output);
+            writeTimings(parser, renderer);
+            return EXIT_SUCCESS;
+        }
+
+        if (parser.isSet("sweep") && parser.isSet("animation"))
+            throw std::runtime_error("Use either --sweep or --animation, not both");
+
+        if (!output.contains("%1"))
+            throw std::runtime_error("The --output of a sweep or animation needs %1 for the frame number");
+
+        QElapsedTimer timer;
+        timer.start();
+
+        const int frame = parser.isSet("animation") ? renderAnimation(parser, renderer, output) : renderSweep(parser, renderer, output);
+
+        std::clog << "Rendered " << frame << " frames in " << timer.elapsed() << " ms" << std::endl;
+
+        const CacheStats cache = renderer.scene().matrixCacheStats();
+        std::clog << "Matrix cache: " << cache.hits << " hits, " << cache.misses << " misses" << std::endl;
+        writeTimings(parser, renderer);
+        return EXIT_SUCCESS;
+    }
+
+    bool isHeadless(int argc, char *argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+            if (std::strcmp(argv[i], "--headless") == 0)
+                return true;
+
+        return false;
+    }
+}
 
 int main(int argc, char *argv[])
 {
+    // Headless rendering must work without a display server. Qt's offscreen platform
+    // only creates OpenGL contexts through GLX though, so without an X display the
+    // software backend is used, unless --backend opengl is given explicitly.
+    if (isHeadless(argc, argv) && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
     // The QApplication is outside the try-catch because
     // QMessageBox requires an active QApplication to work.
 
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Demonstrates how linear algebra is involved in 3D CGI.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("mesh", "OBJ or PLY mesh to show instead of the cube.", "[mesh]");
+    parser.addOption(QCommandLineOption("headless", "Render to image files instead of opening a window."));
+    parser.addOption(QCommandLineOption("output", "Image to write in headless mode (.png, .ppm, ...).", "file"));
+    parser.addOption(QCommandLineOption("size", "Image size in headless mode.", "WxH", "800x600"));
+    parser.addOption(QCommandLineOption("sweep", "File with the scene options of one frame per line.", "file"));
+    parser.addOption(QCommandLineOption("animation", "Keyframe file to play, one time and its scene options per line.", "file"));
+    parser.addOption(QCommandLineOption("fps", "Frame rate of the animation in headless mode.", "fps", "60"));
+    parser.addOption(QCommandLineOption("timings", "CSV file to write frame timings to in headless mode.", "file"));
+    parser.addOption(QCommandLineOption("shader-dir", "Read the shaders from this directory instead of the executable, and reload them when they change.", "dir"));
+    parser.addOption(QCommandLineOption("max-fps", "Highest frame rate in the window, 0 to follow the display.", "fps", "60"));
+    parser.addOption(QCommandLineOption("backend", "Draw with opengl, or with the software rasterizer on machines without a usable OpenGL driver.", "backend", "opengl"));
+    parser.addOption(QCommandLineOption("matrix-display", "Show the matrices with a label per value, or painted in one go.", "labels|painted", "labels"));
+    parser.addOption(QCommandLineOption("startup-time", "Print the time from launch to the first frame on screen, then exit."));
+    SceneOptions::addOptions(parser);
+    parser.process(a);
+
+    if (parser.isSet("headless"))
+    {
+        try
+        {
+            return runHeadless(parser);
+        }
+        catch (const std::exception &ex)
+        {
+            std::cerr << "Fatal error: " << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
     try
     {
         MainWindow w;
+
+        bool ok;
+        const double maxFps = parser.value("max-fps").toDouble(&ok);
+        if (!ok || maxFps < 0.0)
+            throw std::runtime_error("Invalid value for --max-fps: " + parser.value("max-fps").toStdString());
+
+        w.sceneWidget()->scheduler().setMaxFps(maxFps);
+        w.sceneWidget()->setBackend(SceneOptions::parseBackend(parser.value("backend")));
+
+        const QString matrixDisplay = parser.value("matrix-display");
+        if (matrixDisplay == "painted")
+            w.setMatrixDisplayMode(MatrixWidget::DisplayMode::Painted);
+        else if (matrixDisplay != "labels")
+            throw std::runtime_error("Invalid value for --matrix-display: " + matrixDisplay.toStdString());
+
+        if (parser.isSet("shader-dir"))
+            w.setShaderDirectory(parser.value("shader-dir").toStdString());
+
+        // Startup benchmark, the first frame ends it
+        if (parser.isSet("startup-time"))
+        {
+            QObject::connect(w.sceneWidget(), &SceneWidget::frameSwapped, &a, []() {
+                std::cout << "Startup time: " << ProcessInfo::millisecondsSinceStart() << " ms" << std::endl;
+                QApplication::quit();
+            });
+        }
+
+        // Optional mesh to show instead of the cube
+        const QStringList positional = parser.positionalArguments();
+        if (!positional.isEmpty())
+            w.loadMesh(positional.at(0).toStdString());
+
+        if (parser.isSet("animation"))
+            w.loadAnimation(parser.value("animation").toStdString());
+
         w.show();
 
         return a.exec();
@@ -1,5 +1,11 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QKeyEvent>
+#include <QMessageBox>
+#include <QTableView>
+#include <exception>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -45,8 +51,62 @@ MainWindow::MainWindow(QWidget *parent) :
     QGridLayout *lay = static_cast<QGridLayout*>(ui->frame->layout());
     lay->addWidget(spaceLbl, 0, 0, 1, 1, Qt::AlignTop | Qt::AlignLeft);
 
+    // Add changes and recomputes per frame label
+    recomputesLbl = new QLabel(this);
+    recomputesLbl->setMargin(10);
+    onRecomputesPerFrameChanged(ui->sceneWidget->changesPerFrame(), ui->sceneWidget->recomputesPerFrame());
+    lay->addWidget(recomputesLbl, 0, 0, 1, 1, Qt::AlignBottom | Qt::AlignLeft);
+
+    // Add frame timings label
+    timingsLbl = new QLabel(this);
+    timingsLbl->setMargin(10);
+    lay->addWidget(timingsLbl, 0, 0, 1, 1, Qt::AlignTop | Qt::AlignRight);
+
+    // Add shader error label, only shown while a reloaded shader does not compile
+    shaderErrorLbl = new QLabel(this);
+    shaderErrorLbl->setMargin(10);
+    shaderErrorLbl->setStyleSheet("color: red");
+    shaderErrorLbl->setTextFormat(Qt::PlainText);
+    shaderErrorLbl->hide();
+    lay->addWidget(shaderErrorLbl, 0, 0, 1, 1, Qt::AlignBottom | Qt::AlignRight);
+
+    // Refresh timings a few times per second instead of every frame, and not at all while idle
+    timingsTimer = new QTimer(this);
+    timingsTimer->setInterval(500);
+    connect(timingsTimer, &QTimer::timeout, this, &MainWindow::updateTimings);
+    connect(&ui->sceneWidget->scheduler(), &FrameScheduler::frameDue, timingsTimer, [this]() {
+        if (!timingsTimer->isActive())
+            timingsTimer->start();
+    });
+
+    // Pipeline trace, hidden until asked for. It is only recomputed after frames that changed
+    // its inputs, and only while it is shown.
+    traceModel = new PipelineTraceModel(ui->sceneWidget->pipelineTrace(), this);
+    QTableView *traceView = new QTableView(this);
+    traceView->setModel(traceModel);
+    traceView->setFocusPolicy(Qt::NoFocus);
+
+    // Fixed row heights, so the view never measures the rows of large meshes
+    traceView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    traceView->verticalHeader()->setDefaultSectionSize(traceView->fontMetrics().height() + 4);
+
+    traceDock = new QDockWidget("Pipeline per vertex", this);
+    traceDock->setWidget(traceView);
+    addDockWidget(Qt::BottomDockWidgetArea, traceDock);
+    traceDock->hide();
+    connect(ui->sceneWidget, &SceneWidget::frameSwapped, this, &MainWindow::updatePipelineTrace);
+    connect(traceDock, &QDockWidget::visibilityChanged, this, &MainWindow::updatePipelineTrace);
+
     // Connect space changed signal
     connect(ui->sceneWidget, &SceneWidget::currentSpaceChanged, this, &MainWindow::onCurrentSpaceChanged);
+    connect(ui->sceneWidget, &SceneWidget::splitViewChanged, this, &MainWindow::onSplitViewChanged);
+    connect(ui->sceneWidget, &SceneWidget::selectedInstanceChanged, this, &MainWindow::onSelectedInstanceChanged);
+
+    // Connect recomputes per frame signal
+    connect(ui->sceneWidget, &SceneWidget::recomputesPerFrameChanged, this, &MainWindow::onRecomputesPerFrameChanged);
+
+    // Connect shader error signal
+    connect(ui->sceneWidget, &SceneWidget::shaderErrorChanged, this, &MainWindow::onShaderErrorChanged);
 }
 
 MainWindow::~MainWindow()
@@ -54,9 +114,35 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::loadMesh(const std::string &path)
+{
+    ui->sceneWidget->loadMesh(path);
+}
+
+void MainWindow::setShaderDirectory(const std::string &directory)
+{
+    ui->sceneWidget->setShaderDirectory(directory);
+}
+
+SceneWidget *MainWindow::sceneWidget()
+{
+    return ui->sceneWidget;
+}
+
+void MainWindow::setMatrixDisplayMode(MatrixWidget::DisplayMode mode)
+{
+    ui->widget->setDisplayMode(mode);
+    ui->viewMatrixWidget->setDisplayMode(mode);
+    ui->viewMatrixWidget_2->setDisplayMode(mode);
+}
+
 
 void MainWindow::onCurrentSpaceChanged(const SceneWidget::Space space)
 {
+    // The split view shows every space already
+    if (ui->sceneWidget->splitView())
+        return;
+
     QString spaceStr;
     switch (space)
     {
@@ -82,3 +168,97 @@ void MainWindow::onCurrentSpaceChanged(const SceneWidget::Space space)
 
     spaceLbl->setText("Huidige ruimte: " + spaceStr);
 }
+
+void MainWindow::onSplitViewChanged(bool split)
+{
+    if (split)
+        spaceLbl->setText("Alle ruimtes: Model, World, View / NDC, Gerenderde afbeelding");
+    else
+        onCurrentSpaceChanged(ui->sceneWidget->currentSpace());
+}
+
+void MainWindow::onSelectedInstanceChanged(const SceneParameters &parameters)
+{
+    // Only shown, the scene has these values already
+    ui->modelScaleXSlider->showScaledValue(parameters.modelScale.x);
+    ui->modelScaleYSlider->showScaledValue(parameters.modelScale.y);
+    ui->modelScaleZSlider->showScaledValue(parameters.modelScale.z);
+
+    ui->modelRotateXSlider->showScaledValue(parameters.modelRotate.x);
+    ui->modelRotateYSlider->showScaledValue(parameters.modelRotate.y);
+    ui->modelRotateZSlider->showScaledValue(parameters.modelRotate.z);
+
+    ui->modelTranslateXSlider->showScaledValue(parameters.modelTranslate.x);
+    ui->modelTranslateYSlider->showScaledValue(parameters.modelTranslate.y);
+    ui->modelTranslateZSlider->showScaledValue(parameters.modelTranslate.z);
+}
+
+void MainWindow::onRecomputesPerFrameChanged(unsigned changes, unsigned recomputes)
+{
+    // However many sliders moved, a frame recomputes the matrices once
+    recomputesLbl->setText(QString("Wijzigingen / herberekeningen per frame: %1 / %2").arg(changes).arg(recomputes));
+}
+
+void MainWindow::onShaderErrorChanged(const QString &error)
+{
+    shaderErrorLbl->setText("Shader niet herladen:\n" + error.trimmed());
+    shaderErrorLbl->setVisible(!error.isEmpty());
+}
+
+void MainWindow::loadAnimation(const std::string &path)
+{
+    ui->sceneWidget->loadAnimation(path);
+}
+
+void MainWindow::updateTimings()
+{
+    SceneWidget *scene = ui->sceneWidget;
+    const SceneRenderer::FrameInfo frame = scene->frameInfo();
+    const FrameScheduler::Stats stats = scene->scheduler().takeStats();
+
+    timingsLbl->setText(scene->renderer().profiler().summaryText() +
+                        QString("\nMatrixcache: %1 treffers / %2 missers").arg(frame.matrixCache.hits).arg(frame.matrixCache.misses) +
+                        QString("\nZichtbaar: %1 / %2 instanties").arg(frame.numOfVisibleInstances).arg(scene->numOfInstances()) +
+                        QString("\nFrames: %1/s, CPU: %2%").arg(stats.fps, 0, 'f', 1).arg(stats.cpuPercent, 0, 'f', 1));
+
+    // Nothing was drawn since the last refresh, the scene is idle
+    if (stats.frames == 0)
+        timingsTimer->stop();
+}
+
+void MainWindow::updatePipelineTrace()
+{
+    if (traceDock->isVisible() && ui->sceneWidget->updatePipelineTrace())
+        traceModel->refresh();
+}
+
+void MainWindow::keyPressEvent(QKeyEvent *event)
+{
+    // Show or hide the pipeline trace
+    if (event->key() == Qt::Key_L)
+    {
+        traceDock->setVisible(!traceDock->isVisible());
+        return;
+    }
+
+    // Export frame timings
+    if (event->key() == Qt::Key_T)
+    {
+        QString path = QFileDialog::getSaveFileName(this, "Tijden exporteren", "timings.csv", "CSV (*.csv)");
+        if (path.isEmpty())
+            return;
+
+        try
+        {
+            ui->sceneWidget->renderer().profiler().writeCsv(path.toStdString());
+        }
+        catch (const std::exception &ex)
+        {
+            QMessageBox::critical(this, "Error", ex.what());
+        }
+
+        return;
+    }
+
+    QMainWindow::keyPressEvent(event);
+}
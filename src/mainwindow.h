@@ -2,8 +2,13 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QDockWidget>
 #include <QLabel>
+#include <QTimer>
+#include <string>
 #include "scenewidget.h"
+#include "matrixwidget.h"
+#include "pipelinetracemodel.h"
 
 namespace Ui {
 class MainWindow;
@@ -17,12 +22,40 @@ public:
     explicit MainWindow(QWidget *parent = 0);
     ~MainWindow();
 
+    void loadMesh(const std::string &path);
+
+    // Reads the shaders from a directory and reloads them when they change, call before show()
+    void setShaderDirectory(const std::string &directory);
+
+    SceneWidget *sceneWidget();
+
+    // Of the model, view and projection matrix
+    void setMatrixDisplayMode(MatrixWidget::DisplayMode mode);
+
+    // Loads a keyframe file and starts playing it
+    void loadAnimation(const std::string &path);
+
 private slots:
     void onCurrentSpaceChanged(const SceneWidget::Space space);
+    void onSplitViewChanged(bool split);
+    void onSelectedInstanceChanged(const SceneParameters &parameters);
+    void onRecomputesPerFrameChanged(unsigned changes, unsigned recomputes);
+    void onShaderErrorChanged(const QString &error);
+    void updateTimings();
+    void updatePipelineTrace();
+
+protected:
+    virtual void keyPressEvent(QKeyEvent *event);
 
 private:
     Ui::MainWindow *ui;
     QLabel *spaceLbl;
+    QLabel *recomputesLbl;
+    QLabel *timingsLbl;
+    QLabel *shaderErrorLbl;
+    QTimer *timingsTimer;
+    QDockWidget *traceDock;
+    PipelineTraceModel *traceModel;
 };
 
 #endif // MAINWINDOW_H
@@ -1,8 +1,20 @@
 #include "matrixwidget.h"
 #include <QGridLayout>
-#include <QLocale>
+#include <QGuiApplication>
+#include <QPainter>
+#include <QScreen>
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
-MatrixWidget::MatrixWidget(QWidget *parent) : QWidget(parent)
+namespace
+{
+    // Widest text a cell is expected to show
+    const char *const widestCell = "-000.0000";
+}
+
+MatrixWidget::MatrixWidget(QWidget *parent) :
+    QWidget(parent), m_matrix(1.0f), m_displayMode(DisplayMode::Labels), m_locale(QLocale::system()), m_refreshInterval(16)
 {
     QGridLayout *grid = new QGridLayout(this);
 
@@ -13,10 +25,24 @@ MatrixWidget::MatrixWidget(QWidget *parent) : QWidget(parent)
             m_labels[col][row] = new QLabel(this);
             m_labels[col][row]->setAlignment(Qt::AlignCenter);
             grid->addWidget(m_labels[col][row], row, col, 1, 1);
+
+            // Nothing shown yet
+            m_shownValues[col][row] = std::numeric_limits<double>::quiet_NaN();
+            m_shownNegative[col][row] = false;
         }
     }
 
     this->setLayout(grid);
+
+    // Refreshing faster than the screen shows nothing new
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() > 0.0)
+        m_refreshInterval = std::max(1, static_cast<int>(1000.0 / screen->refreshRate()));
+
+    m_refreshTimer.setSingleShot(true);
+    m_refreshTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_refreshTimer, &QTimer::timeout, this, &MatrixWidget::updateDisplay);
+
     updateDisplay();
 }
 
@@ -25,15 +51,107 @@ MatrixWidget::~MatrixWidget()
 
 }
 
+void MatrixWidget::setDisplayMode(DisplayMode mode)
+{
+    m_displayMode = mode;
+
+    for (size_t col = 0; col < 4; ++col)
+    {
+        for (size_t row = 0; row < 4; ++row)
+        {
+            m_labels[col][row]->setText(m_texts[col][row]);
+            m_labels[col][row]->setVisible(mode == DisplayMode::Labels);
+        }
+    }
+
+    updateGeometry();
+    update();
+}
+
+QSize MatrixWidget::sizeHint() const
+{
+    if (m_displayMode == DisplayMode::Labels)
+        return QWidget::sizeHint();
+
+    // Same cell size as a label, the margins and spacing of the layout around them
+    const QGridLayout *grid = static_cast<const QGridLayout *>(layout());
+    const QFontMetrics metrics = fontMetrics();
+    const QMargins margins = grid->contentsMargins();
+
+    return QSize(4 * metrics.width(widestCell) + 3 * grid->horizontalSpacing() + margins.left() + margins.right(),
+                 4 * metrics.height() + 3 * grid->verticalSpacing() + margins.top() + margins.bottom());
+}
+
+void MatrixWidget::scheduleDisplay()
+{
+    // The first change after a quiet period is shown at once, the rest with the next refresh
+    if (m_refreshTimer.isActive())
+        return;
+
+    const qint64 elapsed = m_sinceRefresh.isValid() ? m_sinceRefresh.elapsed() : m_refreshInterval;
+    if (elapsed >= m_refreshInterval)
+        updateDisplay();
+    else
+        m_refreshTimer.start(m_refreshInterval - static_cast<int>(elapsed));
+}
+
 void MatrixWidget::updateDisplay()
 {
+    m_sinceRefresh.start();
+    const double scale = std::pow(10.0, m_precision);
+    bool changed = false;
+
     for (size_t col = 0; col < 4; ++col)
     {
         for (size_t row = 0; row < 4; ++row)
         {
-            QLabel &lbl = *m_labels[col][row];
-            QString txt = QLocale::system().toString(m_matrix[col][row], 'f', m_precision);
-            lbl.setText(txt);
+            // Same text as before when the rounded value and the sign are the same
+            const float value = m_matrix[col][row];
+            const double rounded = std::round(value * scale);
+            const bool negative = std::signbit(value);
+
+            if (rounded == m_shownValues[col][row] && negative == m_shownNegative[col][row])
+                continue;
+
+            m_shownValues[col][row] = rounded;
+            m_shownNegative[col][row] = negative;
+            m_texts[col][row] = m_locale.toString(value, 'f', m_precision);
+            changed = true;
+
+            if (m_displayMode == DisplayMode::Labels)
+                m_labels[col][row]->setText(m_texts[col][row]);
+        }
+    }
+
+    if (changed && m_displayMode == DisplayMode::Painted)
+        update();
+}
+
+void MatrixWidget::paintEvent(QPaintEvent *event)
+{
+    if (m_displayMode == DisplayMode::Labels)
+    {
+        QWidget::paintEvent(event);
+        return;
+    }
+
+    // The cells the labels would have, without their layouts
+    const QGridLayout *grid = static_cast<const QGridLayout *>(layout());
+    const QRect area = contentsRect().marginsRemoved(grid->contentsMargins());
+    const int spacingX = grid->horizontalSpacing();
+    const int spacingY = grid->verticalSpacing();
+    const int cellWidth = (area.width() - 3 * spacingX) / 4;
+    const int cellHeight = (area.height() - 3 * spacingY) / 4;
+
+    QPainter painter(this);
+    painter.setPen(palette().color(QPalette::WindowText));
+
+    for (int col = 0; col < 4; ++col)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            const QRect cell(area.left() + col * (cellWidth + spacingX), area.top() + row * (cellHeight + spacingY), cellWidth, cellHeight);
+            painter.drawText(cell, Qt::AlignCenter, m_texts[col][row]);
         }
     }
 }
@@ -1,10 +1,17 @@
 #ifndef MATRIXWIDGET_H
 #define MATRIXWIDGET_H
 
+#include <QElapsedTimer>
 #include <QLabel>
+#include <QLocale>
+#include <QString>
+#include <QTimer>
 #include <QWidget>
 #include <glm/glm.hpp>
 
+// Shows a 4x4 matrix. The display is refreshed at most once per display refresh,
+// however often the matrix is set, and only cells whose value changed at the
+// shown precision are formatted again.
 class MatrixWidget : public QWidget
 {
     Q_OBJECT
@@ -13,16 +20,46 @@ public:
     explicit MatrixWidget(QWidget *parent = 0);
     ~MatrixWidget();
 
+    // Labels: a label per cell, only the changed ones are set.
+    // Painted: all cells drawn in one paint event, without labels or relayouts.
+    enum class DisplayMode
+    {
+        Labels, Painted
+    };
+
+    DisplayMode displayMode() const { return m_displayMode; }
+    void setDisplayMode(DisplayMode mode);
+
+    virtual QSize sizeHint() const;
+
 signals:
     void matrixChanged(const glm::mat4 &matrix);
 
 public slots:
-    void setMatrix(const glm::mat4 &matrix) { m_matrix = matrix; updateDisplay(); emit matrixChanged(matrix); }
+    void setMatrix(const glm::mat4 &matrix) { m_matrix = matrix; scheduleDisplay(); emit matrixChanged(matrix); }
+
+protected:
+    virtual void paintEvent(QPaintEvent *event);
+
+private slots:
+    void updateDisplay();
 
 private:
+    void scheduleDisplay();
+
     glm::mat4 m_matrix;
+    DisplayMode m_displayMode;
     QLabel *m_labels[4][4];
-    void updateDisplay();
+
+    // Cells as shown, the value is rounded to the precision
+    QString m_texts[4][4];
+    double m_shownValues[4][4];
+    bool m_shownNegative[4][4];
+
+    QLocale m_locale;
+    QTimer m_refreshTimer;
+    QElapsedTimer m_sinceRefresh;
+    int m_refreshInterval;
     static constexpr int m_precision = 4;
 };
 
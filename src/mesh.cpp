@@ -0,0 +1,87 @@
+#include "mesh.h"
+
+Mesh Mesh::cube()
+{
+    Mesh mesh;
+
+    mesh.positions =
+    {
+        // Front face
+        glm::vec3(-1.0f, -1.0f, +1.0f),
+        glm::vec3(-1.0f, +1.0f, +1.0f),
+        glm::vec3(+1.0f, +1.0f, +1.0f),
+        glm::vec3(+1.0f, -1.0f, +1.0f),
+
+        // Right face
+        glm::vec3(+1.0f, -1.0f, +1.0f),
+        glm::vec3(+1.0f, +1.0f, +1.0f),
+        glm::vec3(+1.0f, +1.0f, -1.0f),
+        glm::vec3(+1.0f, -1.0f, -1.0f),
+
+        // Top face
+        glm::vec3(-1.0f, +1.0f, +1.0f),
+        glm::vec3(-1.0f, +1.0f, -1.0f),
+        glm::vec3(+1.0f, +1.0f, -1.0f),
+        glm::vec3(+1.0f, +1.0f, +1.0f),
+
+        // Back face
+        glm::vec3(-1.0f, -1.0f, -1.0f),
+        glm::vec3(-1.0f, +1.0f, -1.0f),
+        glm::vec3(+1.0f, +1.0f, -1.0f),
+        glm::vec3(+1.0f, -1.0f, -1.0f),
+
+        // Left face
+        glm::vec3(-1.0f, -1.0f, +1.0f),
+        glm::vec3(-1.0f, +1.0f, +1.0f),
+        glm::vec3(-1.0f, +1.0f, -1.0f),
+        glm::vec3(-1.0f, -1.0f, -1.0f),
+
+        // Bottom face
+        glm::vec3(-1.0f, -1.0f, +1.0f),
+        glm::vec3(-1.0f, -1.0f, -1.0f),
+        glm::vec3(+1.0f, -1.0f, -1.0f),
+        glm::vec3(+1.0f, -1.0f, +1.0f),
+    };
+
+    const glm::vec3 faceColours[] =
+    {
+        glm::vec3(1.0f, 0.0f, 0.0f), // Front face
+        glm::vec3(0.0f, 1.0f, 0.0f), // Right face
+        glm::vec3(0.0f, 0.0f, 1.0f), // Top face
+        glm::vec3(0.0f, 1.0f, 1.0f), // Back face
+        glm::vec3(1.0f, 0.0f, 1.0f), // Left face
+        glm::vec3(1.0f, 1.0f, 0.0f), // Bottom face
+    };
+
+    for (const glm::vec3 &colour : faceColours)
+        mesh.colours.insert(mesh.colours.end(), 4, colour);
+
+    mesh.indices =
+    {
+        // Front face
+        0, 1, 2,
+        0, 2, 3,
+
+        // Right face
+        4, 5, 6,
+        4, 6, 7,
+
+        // Top face
+        8, 9, 10,
+        8, 10, 11,
+
+        // Back face
+        12, 14, 13,
+        12, 15, 14,
+
+        // Left face
+        16, 18, 17,
+        16, 19, 18,
+
+        // Bottom face
+        20, 22, 21,
+        20, 23, 22,
+    };
+
+    return mesh;
+}
@@ -0,0 +1,22 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Indexed triangle mesh with one colour per vertex.
+// Triangles are wound clockwise, matching glFrontFace(GL_CW) in SceneWidget.
+struct Mesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> colours;
+    std::vector<std::uint32_t> indices;
+
+    std::size_t numOfVertices() const { return positions.size(); }
+    std::size_t numOfTriangles() const { return indices.size() / 3; }
+
+    static Mesh cube();
+};
+
+#endif // MESH_H
@@ -0,0 +1,690 @@
+#include "meshloader.h"
+#include "processinfo.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QString>
+#include <QtGlobal>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+    // Non-owning view on a piece of the mapped file
+    struct Token
+    {
+        const char *begin;
+        const char *end;
+
+        bool operator==(const char *str) const
+        {
+            const std::size_t len = std::strlen(str);
+            return static_cast<std::size_t>(end - begin) == len && std::memcmp(begin, str, len) == 0;
+        }
+    };
+
+    inline bool isSpace(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    inline void skipSpaces(const char *&p, const char *end)
+    {
+        while (p < end && isSpace(*p))
+            ++p;
+    }
+
+    inline bool nextToken(const char *&p, const char *end, Token &token)
+    {
+        skipSpaces(p, end);
+        token.begin = p;
+
+        while (p < end && !isSpace(*p))
+            ++p;
+
+        token.end = p;
+        return token.begin != token.end;
+    }
+
+    inline const char *findLineEnd(const char *p, const char *end)
+    {
+        const void *newline = std::memchr(p, '\n', end - p);
+        return newline ? static_cast<const char*>(newline) : end;
+    }
+
+    bool parseInt(const char *&p, const char *end, long &value)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        if (p == end || !isDigit(*p))
+            return false;
+
+        // Saturates instead of overflowing, no caller accepts a value that large
+        const long max = std::numeric_limits<long>::max();
+        value = 0;
+        while (p < end && isDigit(*p))
+        {
+            const int digit = *p++ - '0';
+            value = value > (max - digit) / 10 ? max : value * 10 + digit;
+        }
+
+        if (negative)
+            value = -value;
+
+        return true;
+    }
+
+    // strtof() needs a terminated string, which a mapped file does not have
+    bool parseFloat(const char *&p, const char *end, float &value)
+    {
+        skipSpaces(p, end);
+
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negative = *p++ == '-';
+
+        double mantissa = 0.0;
+        int exponent = 0;
+        bool hasDigits = false;
+
+        while (p < end && isDigit(*p))
+        {
+            mantissa = mantissa * 10.0 + (*p++ - '0');
+            hasDigits = true;
+        }
+
+        if (p < end && *p == '.')
+        {
+            ++p;
+            while (p < end && isDigit(*p))
+            {
+                mantissa = mantissa * 10.0 + (*p++ - '0');
+                --exponent;
+                hasDigits = true;
+            }
+        }
+
+        if (!hasDigits)
+            return false;
+
+        if (p < end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            long exp;
+            if (!parseInt(p, end, exp))
+                return false;
+
+            // Far beyond the range of a double, which the loop below stops at anyway
+            exponent += static_cast<int>(std::max(-100000L, std::min(exp, 100000L)));
+        }
+
+        double result = mantissa;
+        const double base = exponent < 0 ? 0.1 : 10.0;
+        for (int i = std::abs(exponent); i > 0 && result != 0.0 && !std::isinf(result); --i)
+            result *= base;
+
+        value = static_cast<float>(negative ? -result : result);
+        return true;
+    }
+
+    // Resolves a 1-based (or negative, relative) obj index of one of the vertices read so far
+    std::uint32_t resolveObjIndex(long index, std::size_t numOfPositions)
+    {
+        const long resolved = index > 0 ? index - 1 : static_cast<long>(numOfPositions) + index;
+        if (index == 0 || resolved < 0 || static_cast<std::size_t>(resolved) >= numOfPositions)
+            throw std::runtime_error("Invalid face index in OBJ file");
+
+        return static_cast<std::uint32_t>(resolved);
+    }
+
+    /* PLY */
+
+    enum class PlyType
+    {
+        Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64
+    };
+
+    struct PlyProperty
+    {
+        Token name;
+        PlyType type;
+        PlyType countType; // only for lists
+        bool isList;
+    };
+
+    struct PlyElement
+    {
+        Token name;
+        std::size_t count;
+        std::vector<PlyProperty> properties;
+    };
+
+    PlyType parsePlyType(const Token &token)
+    {
+        if (token == "char" || token == "int8") return PlyType::Int8;
+        if (token == "uchar" || token == "uint8") return PlyType::UInt8;
+        if (token == "short" || token == "int16") return PlyType::Int16;
+        if (token == "ushort" || token == "uint16") return PlyType::UInt16;
+        if (token == "int" || token == "int32") return PlyType::Int32;
+        if (token == "uint" || token == "uint32") return PlyType::UInt32;
+        if (token == "float" || token == "float32") return PlyType::Float32;
+        if (token == "double" || token == "float64") return PlyType::Float64;
+        return PlyType::Invalid;
+    }
+
+    std::size_t plyTypeSize(PlyType type)
+    {
+        switch (type)
+        {
+        case PlyType::Int8:
+        case PlyType::UInt8:
+            return 1;
+        case PlyType::Int16:
+        case PlyType::UInt16:
+            return 2;
+        case PlyType::Int32:
+        case PlyType::UInt32:
+        case PlyType::Float32:
+            return 4;
+        case PlyType::Float64:
+            return 8;
+        default:
+            return 0;
+        }
+    }
+
+    template <typename T>
+    inline T loadPlyScalar(const unsigned char *bytes)
+    {
+        T value;
+        std::memcpy(&value, bytes, sizeof value);
+        return value;
+    }
+
+    double readPlyValue(const char *&p, const char *end, PlyType type, bool swapBytes)
+    {
+        const std::size_t size = plyTypeSize(type);
+        if (static_cast<std::size_t>(end - p) < size)
+            throw std::runtime_error("Unexpected end of PLY file");
+
+        unsigned char bytes[8];
+        std::memcpy(bytes, p, size);
+        if (swapBytes)
+            std::reverse(bytes, bytes + size);
+        p += size;
+
+        switch (type)
+        {
+        case PlyType::Int8: return loadPlyScalar<std::int8_t>(bytes);
+        case PlyType::UInt8: return loadPlyScalar<std::uint8_t>(bytes);
+        case PlyType::Int16: return loadPlyScalar<std::int16_t>(bytes);
+        case PlyType::UInt16: return loadPlyScalar<std::uint16_t>(bytes);
+        case PlyType::Int32: return loadPlyScalar<std::int32_t>(bytes);
+        case PlyType::UInt32: return loadPlyScalar<std::uint32_t>(bytes);
+        case PlyType::Float32: return loadPlyScalar<float>(bytes);
+        case PlyType::Float64: return loadPlyScalar<double>(bytes);
+        default: throw std::runtime_error("Invalid PLY property type");
+        }
+    }
+
+    // Casting a negative or fractional count to an unsigned type is undefined, so those are rejected first
+    std::size_t readPlyListCount(const char *&p, const char *end, PlyType type, bool swapBytes)
+    {
+        const double count = readPlyValue(p, end, type, swapBytes);
+        if (!(count >= 0.0) || count != std::floor(count))
+            throw std::runtime_error("Invalid list count in PLY file");
+
+        // Every item takes at least a byte, which also keeps the cast in range
+        if (count > static_cast<double>(end - p))
+            throw std::runtime_error("Unexpected end of PLY file");
+
+        return static_cast<std::size_t>(count);
+    }
+
+    std::uint32_t readPlyIndex(const char *&p, const char *end, PlyType type, bool swapBytes)
+    {
+        const double index = readPlyValue(p, end, type, swapBytes);
+        if (!(index >= 0.0) || index != std::floor(index) || index > std::numeric_limits<std::uint32_t>::max())
+            throw std::runtime_error("Invalid vertex index in PLY file");
+
+        return static_cast<std::uint32_t>(index);
+    }
+
+    void skipPlyProperty(const char *&p, const char *end, const PlyProperty &property, bool swapBytes)
+    {
+        const std::size_t typeSize = plyTypeSize(property.type);
+        if (typeSize == 0)
+            throw std::runtime_error("Invalid PLY property type");
+
+        const std::size_t count = property.isList ? readPlyListCount(p, end, property.countType, swapBytes) : 1;
+
+        // Divided, a corrupt count cannot overflow the size
+        if (static_cast<std::size_t>(end - p) / typeSize < count)
+            throw std::runtime_error("Unexpected end of PLY file");
+
+        p += count * typeSize;
+    }
+
+    int findPlyProperty(const PlyElement &element, const char *name, const char *altName = nullptr)
+    {
+        for (std::size_t i = 0; i < element.properties.size(); ++i)
+        {
+            const Token &propertyName = element.properties[i].name;
+            if (propertyName == name || (altName && propertyName == altName))
+                return static_cast<int>(i);
+        }
+
+        return -1;
+    }
+}
+
+Mesh MeshLoader::load(const std::string &path)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Map the whole file into memory
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QFile::ReadOnly))
+        throw std::runtime_error("Could not open file: " + path);
+
+    const qint64 size = file.size();
+    const uchar *data = size > 0 ? file.map(0, size) : nullptr;
+    if (!data)
+        throw std::runtime_error("Could not map file: " + path);
+
+    const char *begin = reinterpret_cast<const char*>(data);
+    const char *end = begin + size;
+
+    Mesh mesh;
+    bool hasColours = false;
+
+    if (size >= 3 && std::memcmp(begin, "ply", 3) == 0)
+        loadPly(begin, end, mesh, hasColours);
+    else
+        loadObj(begin, end, mesh, hasColours);
+
+    file.unmap(const_cast<uchar*>(data));
+    file.close();
+
+    finalize(mesh, hasColours);
+
+    // Print load info
+    std::clog << "Mesh: " << path <<
+                 "\nVertices: " << mesh.numOfVertices() <<
+                 "\nTriangles: " << mesh.numOfTriangles() <<
+                 "\nLoad time: " << timer.elapsed() << " ms" <<
+                 "\nPeak RSS: " << ProcessInfo::peakResidentSetSize() / (1024 * 1024) << " MiB" << '\n' << std::endl;
+
+    return mesh;
+}
+
+void MeshLoader::loadObj(const char *begin, const char *end, Mesh &mesh, bool &hasColours)
+{
+    // Reused for every face, so polygons do not allocate per line
+    std::vector<std::uint32_t> corners;
+    std::size_t numOfColours = 0;
+
+    for (const char *p = begin; p < end; )
+    {
+        const char *lineEnd = findLineEnd(p, end);
+        skipSpaces(p, lineEnd);
+
+        // Vertex: v x y z [r g b]
+        if (lineEnd - p > 1 && p[0] == 'v' && isSpace(p[1]))
+        {
+            ++p;
+
+            glm::vec3 position;
+            if (!parseFloat(p, lineEnd, position.x) || !parseFloat(p, lineEnd, position.y) || !parseFloat(p, lineEnd, position.z))
+                throw std::runtime_error("Invalid vertex in OBJ file");
+
+            glm::vec3 colour(1.0f, 1.0f, 1.0f);
+            if (parseFloat(p, lineEnd, colour.x) && parseFloat(p, lineEnd, colour.y) && parseFloat(p, lineEnd, colour.z))
+                ++numOfColours;
+
+            mesh.positions.push_back(position);
+            mesh.colours.push_back(colour);
+        }
+
+        // Face: f v[/vt[/vn]] v[/vt[/vn]] v[/vt[/vn]] ...
+        else if (lineEnd - p > 1 && p[0] == 'f' && isSpace(p[1]))
+        {
+            ++p;
+            corners.clear();
+
+            Token token;
+            while (nextToken(p, lineEnd, token))
+            {
+                // Only the position index is used, texture coords and normals are skipped
+                const char *q = token.begin;
+                long index;
+                if (!parseInt(q, token.end, index))
+                    throw std::runtime_error("Invalid face in OBJ file");
+
+                corners.push_back(resolveObjIndex(index, mesh.positions.size()));
+            }
+
+            // Triangulate as a fan, rewinding counter-clockwise faces to clockwise
+            for (std::size_t i = 1; i + 1 < corners.size(); ++i)
+            {
+                mesh.indices.push_back(corners[0]);
+                mesh.indices.push_back(corners[i + 1]);
+                mesh.indices.push_back(corners[i]);
+            }
+        }
+
+        p = lineEnd + 1;
+    }
+
+    hasColours = numOfColours > 0 && numOfColours == mesh.positions.size();
+}
+
+void MeshLoader::loadPly(const char *begin, const char *end, Mesh &mesh, bool &hasColours)
+{
+    const char *p = findLineEnd(begin, end) + 1;
+
+    // Parse header
+    std::vector<PlyElement> elements;
+    bool bigEndian = false;
+    bool hasFormat = false;
+    bool hasEndHeader = false;
+
+    while (p < end && !hasEndHeader)
+    {
+        const char *lineEnd = findLineEnd(p, end);
+
+        Token keyword;
+        if (nextToken(p, lineEnd, keyword))
+        {
+            Token tokens[4];
+            std::size_t numOfTokens = 0;
+            while (numOfTokens < 4 && nextToken(p, lineEnd, tokens[numOfTokens]))
+                ++numOfTokens;
+
+            if (keyword == "format" && numOfTokens >= 1)
+            {
+                if (tokens[0] == "binary_little_endian")
+                    bigEndian = false;
+                else if (tokens[0] == "binary_big_endian")
+                    bigEndian = true;
+                else
+                    throw std::runtime_error("Only binary PLY files are supported");
+
+                hasFormat = true;
+            }
+            else if (keyword == "element" && numOfTokens >= 2)
+            {
+                const char *q = tokens[1].begin;
+                long count;
+                if (!parseInt(q, tokens[1].end, count) || count < 0)
+                    throw std::runtime_error("Invalid element count in PLY header");
+
+                PlyElement element;
+                element.name = tokens[0];
+                element.count = static_cast<std::size_t>(count);
+                elements.push_back(element);
+            }
+            else if (keyword == "property" && numOfTokens >= 2)
+            {
+                if (elements.empty())
+                    throw std::runtime_error("PLY property outside of an element");
+
+                PlyProperty property;
+                property.isList = tokens[0] == "list";
+
+                if (property.isList)
+                {
+                    if (numOfTokens < 4)
+                        throw std::runtime_error("Invalid list property in PLY header");
+
+                    property.countType = parsePlyType(tokens[1]);
+                    property.type = parsePlyType(tokens[2]);
+                    property.name = tokens[3];
+                }
+                else
+                {
+                    property.countType = PlyType::Invalid;
+                    property.type = parsePlyType(tokens[0]);
+                    property.name = tokens[1];
+                }
+
+                if (property.type == PlyType::Invalid || (property.isList && property.countType == PlyType::Invalid))
+                    throw std::runtime_error("Unknown property type in PLY header");
+
+                elements.back().properties.push_back(property);
+            }
+            else if (keyword == "end_header")
+            {
+                hasEndHeader = true;
+            }
+
+            // Other keywords (comment, obj_info, ...) are ignored
+        }
+
+        p = lineEnd + 1;
+    }
+
+    if (!hasFormat || !hasEndHeader)
+        throw std::runtime_error("Invalid PLY header");
+
+    const bool swapBytes = bigEndian != (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+
+    // Parse body
+    std::size_t numOfColours = 0;
+
+    for (const PlyElement &element : elements)
+    {
+        if (element.name == "vertex")
+        {
+            const int x = findPlyProperty(element, "x");
+            const int y = findPlyProperty(element, "y");
+            const int z = findPlyProperty(element, "z");
+            const int r = findPlyProperty(element, "red", "r");
+            const int g = findPlyProperty(element, "green", "g");
+            const int b = findPlyProperty(element, "blue", "b");
+
+            if (x < 0 || y < 0 || z < 0)
+                throw std::runtime_error("PLY vertices have no position");
+
+            const bool vertexColours = r >= 0 && g >= 0 && b >= 0;
+            const float colourScale = vertexColours && element.properties[r].type == PlyType::UInt8 ? 1.0f / 255.0f : 1.0f;
+
+            mesh.positions.reserve(mesh.positions.size() + element.count);
+            mesh.colours.reserve(mesh.colours.size() + element.count);
+
+            for (std::size_t i = 0; i < element.count; ++i)
+            {
+                float values[6] = { 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f };
+                const int targets[6] = { x, y, z, r, g, b };
+
+                for (int j = 0; j < static_cast<int>(element.properties.size()); ++j)
+                {
+                    const PlyProperty &property = element.properties[j];
+                    const int *target = std::find(targets, targets + 6, j);
+
+                    if (property.isList || target == targets + 6)
+                        skipPlyProperty(p, end, property, swapBytes);
+                    else
+                        values[target - targets] = static_cast<float>(readPlyValue(p, end, property.type, swapBytes));
+                }
+
+                mesh.positions.push_back(glm::vec3(values[0], values[1], values[2]));
+                mesh.colours.push_back(vertexColours ? glm::vec3(values[3], values[4], values[5]) * colourScale : glm::vec3(1.0f, 1.0f, 1.0f));
+            }
+
+            if (vertexColours)
+                numOfColours += element.count;
+        }
+        else if (element.name == "face")
+        {
+            const int list = findPlyProperty(element, "vertex_indices", "vertex_index");
+            if (list < 0 || !element.properties[list].isList)
+                throw std::runtime_error("PLY faces have no vertex indices");
+
+            const PlyProperty &indexProperty = element.properties[list];
+            mesh.indices.reserve(mesh.indices.size() + element.count * 3);
+
+            for (std::size_t i = 0; i < element.count; ++i)
+            {
+                for (int j = 0; j < static_cast<int>(element.properties.size()); ++j)
+                {
+                    if (j != list)
+                    {
+                        skipPlyProperty(p, end, element.properties[j], swapBytes);
+                        continue;
+                    }
+
+                    const std::size_t numOfCorners = readPlyListCount(p, end, indexProperty.countType, swapBytes);
+                    if (numOfCorners < 3)
+                    {
+                        const std::size_t size = numOfCorners * plyTypeSize(indexProperty.type);
+                        if (static_cast<std::size_t>(end - p) < size)
+                            throw std::runtime_error("Unexpected end of PLY file");
+
+                        p += size;
+                        continue;
+                    }
+
+                    // Triangulate as a fan, rewinding counter-clockwise faces to clockwise
+                    const std::uint32_t first = readPlyIndex(p, end, indexProperty.type, swapBytes);
+                    std::uint32_t previous = readPlyIndex(p, end, indexProperty.type, swapBytes);
+
+                    for (std::size_t k = 2; k < numOfCorners; ++k)
+                    {
+                        const std::uint32_t current = readPlyIndex(p, end, indexProperty.type, swapBytes);
+                        mesh.indices.push_back(first);
+                        mesh.indices.push_back(current);
+                        mesh.indices.push_back(previous);
+                        previous = current;
+                    }
+                }
+            }
+        }
+        else
+        {
+            // Skip unknown elements
+            for (std::size_t i = 0; i < element.count; ++i)
+                for (const PlyProperty &property : element.properties)
+                    skipPlyProperty(p, end, property, swapBytes);
+        }
+    }
+
+    hasColours = numOfColours > 0 && numOfColours == mesh.positions.size();
+}
+
+void MeshLoader::finalize(Mesh &mesh, bool hasColours)
+{
+    if (mesh.positions.empty() || mesh.indices.empty())
+        throw std::runtime_error("Mesh contains no triangles");
+
+    for (std::uint32_t index : mesh.indices)
+        if (index >= mesh.positions.size())
+            throw std::runtime_error("Mesh index out of range");
+
+    // Bounding box
+    glm::vec3 min = mesh.positions.front();
+    glm::vec3 max = mesh.positions.front();
+    for (const glm::vec3 &position : mesh.positions)
+    {
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+
+    // Centre the mesh and scale it to fit in the [-1, 1] cube, like the default cube
+    const glm::vec3 centre = (min + max) * 0.5f;
+    const glm::vec3 halfExtent = (max - min) * 0.5f;
+    const float largest = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+    const float scale = largest > 0.0f ? 1.0f / largest : 1.0f;
+
+    for (glm::vec3 &position : mesh.positions)
+        position = (position - centre) * scale;
+
+    // Without vertex colours, colour by position so the shape stays readable without lighting
+    if (!hasColours)
+        for (std::size_t i = 0; i < mesh.positions.size(); ++i)
+            mesh.colours[i] = mesh.positions[i] * 0.5f + glm::vec3(0.5f, 0.5f, 0.5f);
+
+    deduplicate(mesh);
+}
+
+void MeshLoader::deduplicate(Mesh &mesh)
+{
+    const std::size_t numOfVertices = mesh.positions.size();
+    const std::uint32_t empty = std::numeric_limits<std::uint32_t>::max();
+
+    // Open addressing hash table with at most 50% load
+    std::size_t capacity = 16;
+    while (capacity < numOfVertices * 2)
+        capacity *= 2;
+
+    std::vector<std::uint32_t> table(capacity, empty);
+    std::vector<std::uint32_t> remap(numOfVertices);
+    std::uint32_t numOfUnique = 0;
+
+    for (std::size_t i = 0; i < numOfVertices; ++i)
+    {
+        const glm::vec3 &position = mesh.positions[i];
+        const glm::vec3 &colour = mesh.colours[i];
+
+        std::uint32_t bits[6];
+        std::memcpy(bits, &position, sizeof(float) * 3);
+        std::memcpy(bits + 3, &colour, sizeof(float) * 3);
+
+        std::size_t hash = 2166136261u;
+        for (std::uint32_t word : bits)
+            hash = (hash ^ word) * 16777619u;
+
+        for (std::size_t slot = hash & (capacity - 1); ; slot = (slot + 1) & (capacity - 1))
+        {
+            const std::uint32_t candidate = table[slot];
+
+            if (candidate == empty)
+            {
+                // New vertex: move it down to the end of the unique range
+                table[slot] = numOfUnique;
+                mesh.positions[numOfUnique] = position;
+                mesh.colours[numOfUnique] = colour;
+                remap[i] = numOfUnique++;
+                break;
+            }
+
+            if (mesh.positions[candidate] == position && mesh.colours[candidate] == colour)
+            {
+                remap[i] = candidate;
+                break;
+            }
+        }
+    }
+
+    mesh.positions.resize(numOfUnique);
+    mesh.colours.resize(numOfUnique);
+
+    // Remap indices, dropping triangles that collapsed onto merged vertices
+    std::size_t numOfIndices = 0;
+    for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const std::uint32_t a = remap[mesh.indices[i]];
+        const std::uint32_t b = remap[mesh.indices[i + 1]];
+        const std::uint32_t c = remap[mesh.indices[i + 2]];
+
+        if (a == b || b == c || a == c)
+            continue;
+
+        mesh.indices[numOfIndices++] = a;
+        mesh.indices[numOfIndices++] = b;
+        mesh.indices[numOfIndices++] = c;
+    }
+
+    mesh.indices.resize(numOfIndices);
+}
@@ -0,0 +1,25 @@
+#ifndef MESHLOADER_H
+#define MESHLOADER_H
+
+#include "mesh.h"
+#include <string>
+
+// Loads Wavefront OBJ and binary PLY files.
+//
+// Files are memory mapped and parsed in a single pass straight from the mapping,
+// without copying lines into strings. Identical vertices are merged into one
+// indexed buffer, the model is centred and scaled to fit in the [-1, 1] cube, and
+// faces are rewound clockwise so they match the culling setup of the scene.
+class MeshLoader
+{
+public:
+    static Mesh load(const std::string &path);
+
+private:
+    static void loadObj(const char *begin, const char *end, Mesh &mesh, bool &hasColours);
+    static void loadPly(const char *begin, const char *end, Mesh &mesh, bool &hasColours);
+    static void finalize(Mesh &mesh, bool hasColours);
+    static void deduplicate(Mesh &mesh);
+};
+
+#endif // MESHLOADER_H
@@ -0,0 +1,398 @@
+#include "meshsimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+    // Symmetric 4x4 matrix of the sum of squared distances to a set of planes
+    struct Quadric
+    {
+        // xx, xy, xz, xw, yy, yz, yw, zz, zw, ww
+        double m[10];
+
+        Quadric() { std::fill(m, m + 10, 0.0); }
+
+        Quadric(double a, double b, double c, double d, double weight)
+        {
+            m[0] = weight * a * a; m[1] = weight * a * b; m[2] = weight * a * c; m[3] = weight * a * d;
+            m[4] = weight * b * b; m[5] = weight * b * c; m[6] = weight * b * d;
+            m[7] = weight * c * c; m[8] = weight * c * d;
+            m[9] = weight * d * d;
+        }
+
+        Quadric &operator+=(const Quadric &other)
+        {
+            for (int i = 0; i < 10; ++i)
+                m[i] += other.m[i];
+
+            return *this;
+        }
+
+        double error(const glm::vec3 &p) const
+        {
+            const double x = p.x, y = p.y, z = p.z;
+            return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z + 2 * m[3] * x
+                 + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y
+                 + m[7] * z * z + 2 * m[8] * z
+                 + m[9];
+        }
+
+        // Point with the smallest error, if the system is well conditioned
+        bool minimum(glm::vec3 &p) const
+        {
+            const double a = m[0], b = m[1], c = m[2];
+            const double d = m[4], e = m[5], f = m[7];
+
+            const double det = a * (d * f - e * e) - b * (b * f - e * c) + c * (b * e - d * c);
+            if (std::abs(det) < 1e-12)
+                return false;
+
+            // Cramer's rule for A p = -(xw, yw, zw)
+            const double rx = -m[3], ry = -m[6], rz = -m[8];
+            const double x = (rx * (d * f - e * e) - b * (ry * f - e * rz) + c * (ry * e - d * rz)) / det;
+            const double y = (a * (ry * f - e * rz) - rx * (b * f - e * c) + c * (b * rz - ry * c)) / det;
+            const double z = (a * (d * rz - ry * e) - b * (b * rz - ry * c) + rx * (b * e - d * c)) / det;
+
+            p = glm::vec3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+            return true;
+        }
+    };
+
+    struct Collapse
+    {
+        double cost;
+        std::uint32_t v0;
+        std::uint32_t v1;
+        std::uint32_t stamp0;
+        std::uint32_t stamp1;
+        glm::vec3 position;
+        float t; // Position along the edge, for the colour
+
+        bool operator>(const Collapse &other) const { return cost > other.cost; }
+    };
+
+    std::uint64_t edgeKey(std::uint32_t a, std::uint32_t b)
+    {
+        return a < b ? (static_cast<std::uint64_t>(a) << 32) | b : (static_cast<std::uint64_t>(b) << 32) | a;
+    }
+
+    class Simplifier
+    {
+    public:
+        explicit Simplifier(const Mesh &mesh);
+        Mesh run(std::size_t targetTriangles);
+
+    private:
+        void initQuadrics();
+        void pushCollapse(std::uint32_t v0, std::uint32_t v1);
+        bool flips(std::uint32_t v, std::uint32_t other, const glm::vec3 &position) const;
+        void collapse(const Collapse &c);
+        Mesh result() const;
+
+        std::vector<glm::vec3> m_positions;
+        std::vector<glm::vec3> m_colours;
+        std::vector<std::uint32_t> m_indices;
+        std::vector<bool> m_triangleAlive;
+        std::vector<std::vector<std::uint32_t>> m_vertexTriangles;
+        std::vector<Quadric> m_quadrics;
+        std::vector<std::uint32_t> m_stamps;
+        std::vector<bool> m_vertexAlive;
+        std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> m_heap;
+        std::size_t m_numOfTriangles;
+
+        // Bounding box of the input, no vertex moves out of it
+        glm::vec3 m_boundsMin;
+        glm::vec3 m_boundsMax;
+    };
+
+    Simplifier::Simplifier(const Mesh &mesh) :
+        m_positions(mesh.positions), m_colours(mesh.colours), m_indices(mesh.indices),
+        m_triangleAlive(mesh.numOfTriangles(), true), m_vertexTriangles(mesh.numOfVertices()),
+        m_quadrics(mesh.numOfVertices()), m_stamps(mesh.numOfVertices(), 0), m_vertexAlive(mesh.numOfVertices(), true),
+        m_numOfTriangles(mesh.numOfTriangles()), m_boundsMin(0.0f), m_boundsMax(0.0f)
+    {
+        for (std::size_t t = 0; t < m_numOfTriangles; ++t)
+            for (int k = 0; k < 3; ++k)
+                m_vertexTriangles[m_indices[3 * t + k]].push_back(static_cast<std::uint32_t>(t));
+
+        if (!m_positions.empty())
+        {
+            m_boundsMin = m_boundsMax = m_positions.front();
+            for (const glm::vec3 &position : m_positions)
+            {
+                m_boundsMin = glm::min(m_boundsMin, position);
+                m_boundsMax = glm::max(m_boundsMax, position);
+            }
+        }
+    }
+
+    void Simplifier::initQuadrics()
+    {
+        std::unordered_map<std::uint64_t, std::uint32_t> edgeTriangles;
+        edgeTriangles.reserve(3 * m_numOfTriangles);
+
+        for (std::size_t t = 0; t < m_numOfTriangles; ++t)
+        {
+            const std::uint32_t *tri = &m_indices[3 * t];
+            const glm::vec3 &p0 = m_positions[tri[0]];
+            const glm::vec3 cross = glm::cross(m_positions[tri[1]] - p0, m_positions[tri[2]] - p0);
+            const float length = glm::length(cross);
+            if (length <= 0.0f)
+                continue;
+
+            // Area weighted plane of the triangle
+            const glm::vec3 n = cross / length;
+            const Quadric q(n.x, n.y, n.z, -glm::dot(n, p0), 0.5 * length);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                m_quadrics[tri[k]] += q;
+
+                // Remember the triangle of every edge, edges shared by more triangles are not on a boundary
+                const std::uint64_t key = edgeKey(tri[k], tri[(k + 1) % 3]);
+                auto it = edgeTriangles.find(key);
+                if (it == edgeTriangles.end())
+                    edgeTriangles.emplace(key, static_cast<std::uint32_t>(t));
+                else
+                    it->second = UINT32_MAX;
+            }
+        }
+
+        // Planes through boundary edges, perpendicular to their triangle, keep the outline in place
+        for (const auto &edge : edgeTriangles)
+        {
+            if (edge.second == UINT32_MAX)
+                continue;
+
+            const std::uint32_t a = static_cast<std::uint32_t>(edge.first >> 32);
+            const std::uint32_t b = static_cast<std::uint32_t>(edge.first & 0xffffffffu);
+            const std::uint32_t *tri = &m_indices[3 * edge.second];
+
+            const glm::vec3 faceNormal = glm::cross(m_positions[tri[1]] - m_positions[tri[0]], m_positions[tri[2]] - m_positions[tri[0]]);
+            const glm::vec3 edgeVec = m_positions[b] - m_positions[a];
+            const glm::vec3 cross = glm::cross(edgeVec, faceNormal);
+            const float length = glm::length(cross);
+            if (length <= 0.0f)
+                continue;
+
+            const glm::vec3 n = cross / length;
+            const Quadric q(n.x, n.y, n.z, -glm::dot(n, m_positions[a]), 1000.0 * glm::dot(edgeVec, edgeVec));
+            m_quadrics[a] += q;
+            m_quadrics[b] += q;
+        }
+
+        for (const auto &edge : edgeTriangles)
+            pushCollapse(static_cast<std::uint32_t>(edge.first >> 32), static_cast<std::uint32_t>(edge.first & 0xffffffffu));
+    }
+
+    void Simplifier::pushCollapse(std::uint32_t v0, std::uint32_t v1)
+    {
+        Quadric q = m_quadrics[v0];
+        q += m_quadrics[v1];
+
+        const glm::vec3 &p0 = m_positions[v0];
+        const glm::vec3 &p1 = m_positions[v1];
+        const glm::vec3 edge = p1 - p0;
+        const float edgeLength2 = glm::dot(edge, edge);
+
+        // Candidates: the optimum (if it stays near the edge), both ends and the midpoint
+        glm::vec3 candidates[4] = { p0, p1, 0.5f * (p0 + p1), glm::vec3() };
+        int numOfCandidates = 3;
+
+        // On convex parts the optimum lies outside the mesh, which then no longer fits the
+        // [-1, 1] cube of loaded meshes. Kept inside the bounds the other candidates lie in.
+        glm::vec3 optimum;
+        if (q.minimum(optimum) && glm::dot(optimum - candidates[2], optimum - candidates[2]) <= edgeLength2)
+            candidates[numOfCandidates++] = glm::clamp(optimum, m_boundsMin, m_boundsMax);
+
+        Collapse c;
+        c.cost = -1.0;
+        for (int i = 0; i < numOfCandidates; ++i)
+        {
+            const double cost = q.error(candidates[i]);
+            if (c.cost < 0.0 || cost < c.cost)
+            {
+                c.cost = cost;
+                c.position = candidates[i];
+            }
+        }
+
+        c.cost = std::max(c.cost, 0.0);
+        c.v0 = v0;
+        c.v1 = v1;
+        c.stamp0 = m_stamps[v0];
+        c.stamp1 = m_stamps[v1];
+        c.t = edgeLength2 > 0.0f ? glm::clamp(glm::dot(c.position - p0, edge) / edgeLength2, 0.0f, 1.0f) : 0.0f;
+
+        m_heap.push(c);
+    }
+
+    // Whether moving v to position turns one of its triangles (not shared with other) around
+    bool Simplifier::flips(std::uint32_t v, std::uint32_t other, const glm::vec3 &position) const
+    {
+        for (std::uint32_t t : m_vertexTriangles[v])
+        {
+            if (!m_triangleAlive[t])
+                continue;
+
+            const std::uint32_t *tri = &m_indices[3 * t];
+            if (tri[0] == other || tri[1] == other || tri[2] == other)
+                continue;
+
+            glm::vec3 before[3], after[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                before[k] = m_positions[tri[k]];
+                after[k] = tri[k] == v ? position : before[k];
+            }
+
+            // Degenerate triangles have no orientation to lose
+            const glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+            if (glm::dot(n0, n0) <= 0.0f)
+                continue;
+
+            const glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+            if (glm::dot(n0, n1) <= 0.0f)
+                return true;
+        }
+
+        return false;
+    }
+
+    void Simplifier::collapse(const Collapse &c)
+    {
+        const std::uint32_t v0 = c.v0;
+        const std::uint32_t v1 = c.v1;
+
+        m_positions[v0] = c.position;
+        m_colours[v0] = glm::mix(m_colours[v0], m_colours[v1], c.t);
+        m_quadrics[v0] += m_quadrics[v1];
+
+        // Triangles on the edge disappear, the others of v1 move over to v0
+        for (std::uint32_t t : m_vertexTriangles[v1])
+        {
+            if (!m_triangleAlive[t])
+                continue;
+
+            std::uint32_t *tri = &m_indices[3 * t];
+            if (tri[0] == v0 || tri[1] == v0 || tri[2] == v0)
+            {
+                m_triangleAlive[t] = false;
+                --m_numOfTriangles;
+                continue;
+            }
+
+            for (int k = 0; k < 3; ++k)
+                if (tri[k] == v1)
+                    tri[k] = v0;
+
+            m_vertexTriangles[v0].push_back(t);
+        }
+
+        m_vertexTriangles[v1].clear();
+        m_vertexTriangles[v1].shrink_to_fit();
+        m_vertexAlive[v1] = false;
+        ++m_stamps[v0];
+
+        // Drop dead triangles and queue the new edges of v0
+        std::vector<std::uint32_t> &triangles = m_vertexTriangles[v0];
+        triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [this](std::uint32_t t) { return !m_triangleAlive[t]; }), triangles.end());
+
+        std::vector<std::uint32_t> neighbours;
+        for (std::uint32_t t : triangles)
+            for (int k = 0; k < 3; ++k)
+                if (m_indices[3 * t + k] != v0)
+                    neighbours.push_back(m_indices[3 * t + k]);
+
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+        for (std::uint32_t n : neighbours)
+            pushCollapse(v0, n);
+    }
+
+    Mesh Simplifier::run(std::size_t targetTriangles)
+    {
+        initQuadrics();
+
+        while (m_numOfTriangles > targetTriangles && !m_heap.empty())
+        {
+            const Collapse c = m_heap.top();
+            m_heap.pop();
+
+            // Skip collapses of edges that changed since they were queued
+            if (!m_vertexAlive[c.v0] || !m_vertexAlive[c.v1] || m_stamps[c.v0] != c.stamp0 || m_stamps[c.v1] != c.stamp1)
+                continue;
+
+            if (flips(c.v0, c.v1, c.position) || flips(c.v1, c.v0, c.position))
+                continue;
+
+            collapse(c);
+        }
+
+        return result();
+    }
+
+    Mesh Simplifier::result() const
+    {
+        Mesh mesh;
+        std::vector<std::uint32_t> remap(m_positions.size(), UINT32_MAX);
+
+        for (std::size_t t = 0; t < m_triangleAlive.size(); ++t)
+        {
+            if (!m_triangleAlive[t])
+                continue;
+
+            for (int k = 0; k < 3; ++k)
+            {
+                const std::uint32_t v = m_indices[3 * t + k];
+                if (remap[v] == UINT32_MAX)
+                {
+                    remap[v] = static_cast<std::uint32_t>(mesh.positions.size());
+                    mesh.positions.push_back(m_positions[v]);
+                    mesh.colours.push_back(m_colours[v]);
+                }
+
+                mesh.indices.push_back(remap[v]);
+            }
+        }
+
+        return mesh;
+    }
+}
+
+Mesh MeshSimplifier::simplify(const Mesh &mesh, std::size_t targetTriangles)
+{
+    if (mesh.numOfTriangles() <= targetTriangles)
+        return mesh;
+
+    return Simplifier(mesh).run(targetTriangles);
+}
+
+std::vector<Mesh> MeshSimplifier::buildLods(Mesh mesh, std::size_t maxLevels, std::size_t minTriangles)
+{
+    std::vector<Mesh> lods;
+    lods.push_back(std::move(mesh));
+
+    while (lods.size() < maxLevels)
+    {
+        const std::size_t target = lods.back().numOfTriangles() / 4;
+        if (target < minTriangles)
+            break;
+
+        // Each level starts from the previous one, which is a lot cheaper than from the full mesh
+        Mesh lod = simplify(lods.back(), target);
+
+        // Stop when the simplifier got stuck (e.g. only boundaries left)
+        if (lod.numOfTriangles() >= lods.back().numOfTriangles())
+            break;
+
+        lods.push_back(std::move(lod));
+    }
+
+    return lods;
+}
@@ -0,0 +1,24 @@
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include "mesh.h"
+#include <cstddef>
+#include <vector>
+
+// Reduces the number of triangles of a mesh with quadric error metrics
+// (Garland & Heckbert): edges are collapsed cheapest first, where the cost of
+// a collapse is the squared distance of the new vertex to the planes of the
+// triangles it replaces. Open boundaries are kept in place, and collapses that
+// would flip a triangle are skipped.
+class MeshSimplifier
+{
+public:
+    // Collapses edges until at most targetTriangles are left, or no collapse is possible
+    static Mesh simplify(const Mesh &mesh, std::size_t targetTriangles);
+
+    // The mesh itself followed by versions with a quarter of the triangles of the
+    // previous one, as long as those have at least minTriangles
+    static std::vector<Mesh> buildLods(Mesh mesh, std::size_t maxLevels, std::size_t minTriangles);
+};
+
+#endif // MESHSIMPLIFIER_H
@@ -0,0 +1,88 @@
+#include "offscreenrenderer.h"
+#include <QOpenGLFramebufferObjectFormat>
+#include <stdexcept>
+
+OffscreenRenderer::OffscreenRenderer(int width, int height, SceneRenderer::Backend backend) :
+    m_fbo(nullptr), m_resolveFbo(nullptr)
+{
+    if (width <= 0 || height <= 0)
+        throw std::runtime_error("Invalid frame size");
+
+    m_scene.setBackend(backend);
+
+    if (backend == SceneRenderer::Backend::Software)
+    {
+        m_scene.initialize();
+        m_scene.resize(width, height);
+        return;
+    }
+
+    // Create context
+    const QSurfaceFormat format = SceneRenderer::surfaceFormat();
+
+    m_surface.setFormat(format);
+    m_surface.create();
+
+    m_context.setFormat(format);
+    if (!m_context.create() || !m_context.makeCurrent(&m_surface))
+        throw std::runtime_error("Could not create an offscreen OpenGL context.\nDo you have OpenGL v3.3? Otherwise use --backend software.");
+
+    // Multisampled framebuffer to render in
+    QOpenGLFramebufferObjectFormat fboFormat;
+    fboFormat.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    fboFormat.setSamples(format.samples());
+    m_fbo = new QOpenGLFramebufferObject(width, height, fboFormat);
+
+    // Single sampled framebuffer to read back from
+    m_resolveFbo = new QOpenGLFramebufferObject(width, height);
+
+    // Init scene
+    m_fbo->bind();
+    m_scene.initialize();
+    m_scene.resize(width, height);
+}
+
+bool OffscreenRenderer::isOpenGLAvailable()
+{
+    const QSurfaceFormat format = SceneRenderer::surfaceFormat();
+
+    QOffscreenSurface surface;
+    surface.setFormat(format);
+    surface.create();
+
+    QOpenGLContext context;
+    context.setFormat(format);
+    if (!context.create() || !context.makeCurrent(&surface))
+        return false;
+
+    // Drivers may hand out an older version than asked for
+    const QSurfaceFormat created = context.format();
+    context.doneCurrent();
+    return created.version() >= qMakePair(3, 3);
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+    if (!m_fbo)
+        return;
+
+    m_context.makeCurrent(&m_surface);
+    delete m_resolveFbo;
+    delete m_fbo;
+    m_context.doneCurrent();
+}
+
+QImage OffscreenRenderer::renderFrame()
+{
+    if (m_scene.backend() == SceneRenderer::Backend::Software)
+    {
+        m_scene.render();
+        return m_scene.softwareImage();
+    }
+
+    m_fbo->bind();
+    m_scene.render();
+
+    QOpenGLFramebufferObject::blitFramebuffer(m_resolveFbo, m_fbo);
+    return m_resolveFbo->toImage();
+}
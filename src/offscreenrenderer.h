@@ -0,0 +1,35 @@
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include "scenerenderer.h"
+
+// Renders the scene into a framebuffer object without any window,
+// for batch rendering on machines without a display. The software
+// backend needs no OpenGL context at all.
+class OffscreenRenderer
+{
+public:
+    OffscreenRenderer(int width, int height, SceneRenderer::Backend backend = SceneRenderer::Backend::OpenGL);
+    ~OffscreenRenderer();
+
+    // Whether an OpenGL 3.3 context can be created without a window
+    static bool isOpenGLAvailable();
+
+    SceneRenderer &scene() { return m_scene; }
+
+    // Renders one frame with the current scene parameters
+    QImage renderFrame();
+
+private:
+    QOffscreenSurface m_surface;
+    QOpenGLContext m_context;
+    QOpenGLFramebufferObject *m_fbo;
+    QOpenGLFramebufferObject *m_resolveFbo;
+    SceneRenderer m_scene;
+};
+
+#endif // OFFSCREENRENDERER_H
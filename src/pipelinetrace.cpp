@@ -0,0 +1,134 @@
+#include "pipelinetrace.h"
+#include "threadpool.h"
+#include <algorithm>
+
+namespace
+{
+    // Floats in a cache line, every component is padded to a multiple of this
+    const std::size_t componentAlignment = 16;
+
+    // Takes NDC to window coordinates, the transformation glViewport() and glDepthRange(0, 1) set up
+    glm::mat4 viewportMatrix(const glm::ivec4 &viewport)
+    {
+        const float halfWidth = 0.5f * viewport.z;
+        const float halfHeight = 0.5f * viewport.w;
+
+        glm::mat4 matrix;
+        matrix[0][0] = halfWidth;
+        matrix[1][1] = halfHeight;
+        matrix[2][2] = 0.5f;
+        matrix[3] = glm::vec4(viewport.x + halfWidth, viewport.y + halfHeight, 0.5f, 1.0f);
+        return matrix;
+    }
+}
+
+PipelineTrace::PipelineTrace() : m_components(), m_size(0), m_versions(), m_valid(false)
+{
+
+}
+
+int PipelineTrace::numOfComponents(Stage stage)
+{
+    return stage == World || stage == View || stage == Clip ? 4 : 3;
+}
+
+const char *PipelineTrace::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Model:
+        return "Model";
+    case World:
+        return "World";
+    case View:
+        return "View";
+    case Clip:
+        return "Clip";
+    case NDC:
+        return "NDC";
+    case Window:
+        return "Window";
+    default:
+        return "Unknown";
+    }
+}
+
+void PipelineTrace::allocate(std::size_t size)
+{
+    m_size = size;
+
+    const std::size_t stride = (size + componentAlignment - 1) / componentAlignment * componentAlignment;
+    std::size_t numOfComponents = 0;
+    for (int stage = 0; stage < NumOfStages; ++stage)
+        numOfComponents += PipelineTrace::numOfComponents(static_cast<Stage>(stage));
+
+    // Only grows, a smaller mesh reuses the memory of a larger one
+    if (m_arena.size() < stride * numOfComponents + componentAlignment)
+        m_arena.resize(stride * numOfComponents + componentAlignment);
+
+    float *next = m_arena.data();
+    next += (componentAlignment - reinterpret_cast<std::uintptr_t>(next) / sizeof(float) % componentAlignment) % componentAlignment;
+
+    for (int stage = 0; stage < NumOfStages; ++stage)
+    {
+        for (int component = 0; component < 4; ++component)
+        {
+            if (component < PipelineTrace::numOfComponents(static_cast<Stage>(stage)))
+            {
+                m_components[stage][component] = next;
+                next += stride;
+            }
+            else
+            {
+                m_components[stage][component] = nullptr;
+            }
+        }
+    }
+}
+
+bool PipelineTrace::update(const Versions &versions, const PositionBuffer &positions, const glm::mat4 &model,
+                           const glm::mat4 &view, const glm::mat4 &projection, const glm::ivec4 &viewport)
+{
+    if (m_valid && versions == m_versions)
+        return false;
+
+    allocate(positions.size());
+
+    const TransformEngine::Kernel kernel = TransformEngine::kernel();
+    const glm::mat4 modelView = view * model;
+    const glm::mat4 mvp = projection * modelView;
+    const glm::mat4 window = viewportMatrix(viewport);
+
+    // Every chunk goes through all stages at once, while its vertices are still in the cache.
+    // World, view and clip are transformed from the model coordinates with the combined matrix,
+    // NDC too: its sums are the same as in clip space, so it equals clip / w exactly.
+    ThreadPool::instance().parallelFor(m_size, TransformEngine::parallelThreshold / 2, [&](std::size_t begin, std::size_t end)
+    {
+        const std::size_t count = end - begin;
+        float *c[NumOfStages][4];
+        for (int stage = 0; stage < NumOfStages; ++stage)
+            for (int component = 0; component < 4; ++component)
+                c[stage][component] = m_components[stage][component] ? m_components[stage][component] + begin : nullptr;
+
+        std::copy(positions.x.begin() + begin, positions.x.begin() + end, c[Model][0]);
+        std::copy(positions.y.begin() + begin, positions.y.begin() + end, c[Model][1]);
+        std::copy(positions.z.begin() + begin, positions.z.begin() + end, c[Model][2]);
+
+        TransformEngine::transform(kernel, model, c[Model][0], c[Model][1], c[Model][2],
+                                   c[World][0], c[World][1], c[World][2], c[World][3], count);
+        TransformEngine::transform(kernel, modelView, c[Model][0], c[Model][1], c[Model][2],
+                                   c[View][0], c[View][1], c[View][2], c[View][3], count);
+        TransformEngine::transform(kernel, mvp, c[Model][0], c[Model][1], c[Model][2],
+                                   c[Clip][0], c[Clip][1], c[Clip][2], c[Clip][3], count);
+        TransformEngine::transformToNdc(kernel, mvp, c[Model][0], c[Model][1], c[Model][2],
+                                        c[NDC][0], c[NDC][1], c[NDC][2], count);
+
+        // The viewport matrix keeps w at 1, the division leaves the values as they are
+        TransformEngine::transformToNdc(kernel, window, c[NDC][0], c[NDC][1], c[NDC][2],
+                                        c[Window][0], c[Window][1], c[Window][2], count);
+    });
+
+    m_versions = versions;
+    m_valid = true;
+    return true;
+}
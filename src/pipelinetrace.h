@@ -0,0 +1,57 @@
+#ifndef PIPELINETRACE_H
+#define PIPELINETRACE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "transformengine.h"
+
+// Coordinates of every mesh vertex in every step of the pipeline, for showing how
+// a vertex travels from model space to the window rather than only the end result.
+//
+// All stages are computed at once with the TransformEngine kernels, in chunks on the
+// thread pool, into one arena that is reused between updates. Reading a value is a
+// lookup, so a table can show it for 10^5+ vertices without recomputing anything.
+class PipelineTrace
+{
+public:
+    enum Stage
+    {
+        Model, World, View, Clip, NDC, Window, NumOfStages
+    };
+
+    // Versions of the mesh, model, view and projection matrices and the viewport
+    typedef std::array<std::uint64_t, 5> Versions;
+
+    PipelineTrace();
+
+    // x, y, z and for the homogeneous stages also w
+    static int numOfComponents(Stage stage);
+    static const char *stageName(Stage stage);
+
+    // Recomputes every stage when one of the versions differs from the last update, returns true if it did.
+    // The viewport maps NDC to window coordinates like glViewport(), with depth in [0, 1].
+    bool update(const Versions &versions, const PositionBuffer &positions, const glm::mat4 &model,
+                const glm::mat4 &view, const glm::mat4 &projection, const glm::ivec4 &viewport);
+
+    std::size_t size() const { return m_size; }
+
+    // One component of a stage for all vertices
+    const float *component(Stage stage, int component) const { return m_components[stage][component]; }
+    float value(std::size_t vertex, Stage stage, int component) const { return m_components[stage][component][vertex]; }
+
+private:
+    void allocate(std::size_t size);
+
+    // Components of all stages after each other, every one starting on a cache line
+    std::vector<float> m_arena;
+    float *m_components[NumOfStages][4];
+    std::size_t m_size;
+
+    Versions m_versions;
+    bool m_valid;
+};
+
+#endif // PIPELINETRACE_H
@@ -0,0 +1,71 @@
+#include "pipelinetracemodel.h"
+
+namespace
+{
+    const char componentNames[] = "xyzw";
+}
+
+PipelineTraceModel::PipelineTraceModel(const PipelineTrace &trace, QObject *parent) :
+    QAbstractTableModel(parent), m_trace(trace), m_numOfRows(static_cast<int>(trace.size())), m_locale(QLocale::system())
+{
+    for (int stage = 0; stage < PipelineTrace::NumOfStages; ++stage)
+    {
+        const PipelineTrace::Stage traceStage = static_cast<PipelineTrace::Stage>(stage);
+        for (int component = 0; component < PipelineTrace::numOfComponents(traceStage); ++component)
+            m_columns.push_back({traceStage, component});
+    }
+}
+
+int PipelineTraceModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_numOfRows;
+}
+
+int PipelineTraceModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_columns.size());
+}
+
+QVariant PipelineTraceModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || static_cast<std::size_t>(index.row()) >= m_trace.size())
+        return QVariant();
+
+    if (role == Qt::TextAlignmentRole)
+        return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    const Column &column = m_columns[index.column()];
+    return m_locale.toString(m_trace.value(index.row(), column.stage, column.component), 'f', m_precision);
+}
+
+QVariant PipelineTraceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    // Vertices are numbered like the indices of the mesh
+    if (orientation == Qt::Vertical)
+        return section;
+
+    const Column &column = m_columns[section];
+    return QString("%1 %2").arg(PipelineTrace::stageName(column.stage)).arg(componentNames[column.component]);
+}
+
+void PipelineTraceModel::refresh()
+{
+    const int numOfRows = static_cast<int>(m_trace.size());
+    if (numOfRows != m_numOfRows)
+    {
+        beginResetModel();
+        m_numOfRows = numOfRows;
+        endResetModel();
+    }
+    else if (numOfRows > 0)
+    {
+        // The view repaints the visible cells only
+        emit dataChanged(index(0, 0), index(numOfRows - 1, columnCount() - 1), {Qt::DisplayRole});
+    }
+}
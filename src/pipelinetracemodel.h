@@ -0,0 +1,41 @@
+#ifndef PIPELINETRACEMODEL_H
+#define PIPELINETRACEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QLocale>
+#include <vector>
+#include "pipelinetrace.h"
+
+// Shows a PipelineTrace as a table, a row per vertex and a column per component of every stage.
+// Cells are only formatted when the view asks for them, so only the visible ones are.
+class PipelineTraceModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit PipelineTraceModel(const PipelineTrace &trace, QObject *parent = 0);
+
+    virtual int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    virtual QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    virtual QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+    // Call after the trace was recomputed
+    void refresh();
+
+private:
+    struct Column
+    {
+        PipelineTrace::Stage stage;
+        int component;
+    };
+
+    const PipelineTrace &m_trace;
+    std::vector<Column> m_columns;
+    int m_numOfRows;
+    QLocale m_locale;
+
+    static constexpr int m_precision = 4;
+};
+
+#endif // PIPELINETRACEMODEL_H
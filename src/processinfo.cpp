@@ -0,0 +1,124 @@
+#include "processinfo.h"
+#include <QtGlobal>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_MAC)
+#include <sys/sysctl.h>
+#elif defined(Q_OS_LINUX)
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#endif
+
+std::size_t ProcessInfo::peakResidentSetSize()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters))
+        return 0;
+
+    return counters.PeakWorkingSetSize;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+
+#if defined(Q_OS_MAC)
+    return static_cast<std::size_t>(usage.ru_maxrss); // bytes
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+#else
+    return 0;
+#endif
+}
+
+double ProcessInfo::cpuSeconds()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return 0.0;
+
+    // Both in units of 100 ns
+    ULARGE_INTEGER kernelTime, userTime;
+    kernelTime.LowPart = kernel.dwLowDateTime;
+    kernelTime.HighPart = kernel.dwHighDateTime;
+    userTime.LowPart = user.dwLowDateTime;
+    userTime.HighPart = user.dwHighDateTime;
+
+    return (kernelTime.QuadPart + userTime.QuadPart) / 1.0e7;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1.0e6;
+#else
+    return 0.0;
+#endif
+}
+
+double ProcessInfo::millisecondsSinceStart()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+        return -1.0;
+
+    GetSystemTimeAsFileTime(&now);
+
+    // Both in units of 100 ns
+    ULARGE_INTEGER start, current;
+    start.LowPart = creation.dwLowDateTime;
+    start.HighPart = creation.dwHighDateTime;
+    current.LowPart = now.dwLowDateTime;
+    current.HighPart = now.dwHighDateTime;
+
+    return (current.QuadPart - start.QuadPart) / 1.0e4;
+#elif defined(Q_OS_MAC)
+    int mib[] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, getpid() };
+    struct kinfo_proc info;
+    size_t size = sizeof info;
+    if (sysctl(mib, 4, &info, &size, nullptr, 0) != 0)
+        return -1.0;
+
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+
+    const struct timeval &start = info.kp_proc.p_starttime;
+    return (now.tv_sec - start.tv_sec) * 1.0e3 + (now.tv_usec - start.tv_usec) / 1.0e3;
+#elif defined(Q_OS_LINUX)
+    // Start time in clock ticks after boot is the 22nd field, the name before it may hold spaces
+    std::ifstream statFile("/proc/self/stat");
+    const std::string stat((std::istreambuf_iterator<char>(statFile)), std::istreambuf_iterator<char>());
+    const std::string::size_type nameEnd = stat.rfind(')');
+    if (nameEnd == std::string::npos)
+        return -1.0;
+
+    std::istringstream fields(stat.substr(nameEnd + 2));
+    std::string field;
+    for (int i = 3; i < 22; ++i)
+        fields >> field;
+
+    unsigned long long startTicks;
+    double uptime;
+    std::ifstream uptimeFile("/proc/uptime");
+    if (!(fields >> startTicks) || !(uptimeFile >> uptime))
+        return -1.0;
+
+    // Only as precise as a clock tick, usually 10 ms
+    return (uptime - static_cast<double>(startTicks) / sysconf(_SC_CLK_TCK)) * 1.0e3;
+#else
+    return -1.0;
+#endif
+}
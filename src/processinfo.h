@@ -0,0 +1,18 @@
+#ifndef PROCESSINFO_H
+#define PROCESSINFO_H
+
+#include <cstddef>
+
+namespace ProcessInfo
+{
+    // Largest resident set size of this process so far, in bytes (0 if unknown)
+    std::size_t peakResidentSetSize();
+
+    // User and system CPU time of all threads of this process so far, in seconds (0 if unknown)
+    double cpuSeconds();
+
+    // Wall clock time since the process was launched, in milliseconds (negative if unknown)
+    double millisecondsSinceStart();
+}
+
+#endif // PROCESSINFO_H
@@ -0,0 +1,72 @@
+#include "renderthread.h"
+#include <QOpenGLContext>
+#include <exception>
+
+RenderThread::RenderThread(SceneRenderer &renderer, QWindow *window, TripleBuffer<SceneRenderer::State> &states,
+                           TripleBuffer<SceneRenderer::FrameInfo> &frameInfos, QObject *parent) :
+    QThread(parent), m_renderer(renderer), m_window(window), m_states(states), m_frameInfos(frameInfos), m_stopping(false)
+{
+
+}
+
+RenderThread::~RenderThread()
+{
+    stop();
+}
+
+void RenderThread::stop()
+{
+    m_stopping = true;
+    m_frameRequests.release();
+    wait();
+}
+
+void RenderThread::run()
+{
+    // The context belongs to this thread, it is current here for as long as it lives
+    QOpenGLContext context;
+    context.setFormat(SceneRenderer::surfaceFormat());
+
+    if (!QOpenGLContext::supportsThreadedOpenGL() || !context.create() || !context.makeCurrent(m_window))
+    {
+        emit failed("Could not create an OpenGL 3.3 context for the render thread. Otherwise use --backend software.");
+        return;
+    }
+
+    try
+    {
+        m_renderer.initialize();
+        emit initialized();
+
+        renderLoop();
+    }
+    catch (const std::exception &ex)
+    {
+        emit failed(ex.what());
+    }
+
+    context.doneCurrent();
+}
+
+void RenderThread::renderLoop()
+{
+    while (true)
+    {
+        m_frameRequests.acquire();
+        if (m_stopping)
+            return;
+
+        // Every request made until now is handled by this frame
+        m_frameRequests.tryAcquire(m_frameRequests.available());
+
+        if (m_states.update())
+            m_renderer.setState(m_states.front());
+
+        m_renderer.render();
+        QOpenGLContext::currentContext()->swapBuffers(m_window);
+
+        m_frameInfos.back() = m_renderer.frameInfo();
+        m_frameInfos.publish();
+        emit frameSwapped();
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QSemaphore>
+#include <QString>
+#include <QThread>
+#include <QWindow>
+#include <atomic>
+#include "scenerenderer.h"
+#include "triplebuffer.h"
+
+// Draws the scene into a window with an OpenGL context of its own, so a frame
+// that waits for the driver or the swap never blocks the user interface. The
+// UI thread publishes the scene state, every frame takes the latest one.
+class RenderThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    RenderThread(SceneRenderer &renderer, QWindow *window, TripleBuffer<SceneRenderer::State> &states,
+                 TripleBuffer<SceneRenderer::FrameInfo> &frameInfos, QObject *parent = 0);
+    ~RenderThread();
+
+    // Never blocks, requests made while a frame is drawn are merged into the next one
+    void requestFrame() { m_frameRequests.release(); }
+
+    // Finishes the current frame and waits for the thread to end
+    void stop();
+
+signals:
+    void initialized();
+    void frameSwapped();
+
+    // The context could not be created or the renderer threw, the thread ended
+    void failed(const QString &error);
+
+protected:
+    virtual void run();
+
+private:
+    void renderLoop();
+
+    SceneRenderer &m_renderer;
+    QWindow *m_window;
+    TripleBuffer<SceneRenderer::State> &m_states;
+    TripleBuffer<SceneRenderer::FrameInfo> &m_frameInfos;
+    QSemaphore m_frameRequests;
+    std::atomic<bool> m_stopping;
+};
+
+#endif // RENDERTHREAD_H
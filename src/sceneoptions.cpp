@@ -0,0 +1,176 @@
+#include "sceneoptions.h"
+#include <QCommandLineOption>
+#include <QStringList>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+namespace
+{
+    float parseFloat(const QString &name, const QString &value)
+    {
+        bool ok;
+        const float result = value.toFloat(&ok);
+
+        if (!ok)
+            throw std::runtime_error("Invalid value for --" + name.toStdString() + ": " + value.toStdString());
+
+        return result;
+    }
+
+    glm::vec3 parseVec3(const QString &name, const QString &value)
+    {
+        const QStringList parts = value.split(',');
+
+        if (parts.size() != 3)
+            throw std::runtime_error("Expected x,y,z for --" + name.toStdString() + ": " + value.toStdString());
+
+        return glm::vec3(parseFloat(name, parts.at(0)), parseFloat(name, parts.at(1)), parseFloat(name, parts.at(2)));
+    }
+}
+
+void SceneOptions::addOptions(QCommandLineParser &parser)
+{
+    parser.addOption(QCommandLineOption("model-scale", "Model scale.", "x,y,z"));
+    parser.addOption(QCommandLineOption("model-rotate", "Model rotation in degrees.", "x,y,z"));
+    parser.addOption(QCommandLineOption("model-translate", "Model translation.", "x,y,z"));
+    parser.addOption(QCommandLineOption("view-position", "Camera position.", "x,y,z"));
+    parser.addOption(QCommandLineOption("view-target", "Camera target.", "x,y,z"));
+    parser.addOption(QCommandLineOption("view-up", "Camera up vector.", "x,y,z"));
+    parser.addOption(QCommandLineOption("near", "Near plane distance.", "distance"));
+    parser.addOption(QCommandLineOption("far", "Far plane distance.", "distance"));
+    parser.addOption(QCommandLineOption("fov", "Vertical field of view in degrees.", "degrees"));
+    parser.addOption(QCommandLineOption("vertex-format", "Storage of the mesh positions: float, half or snorm16.", "format"));
+    parser.addOption(QCommandLineOption("instances", "Number of instances of the mesh to draw.", "count"));
+    parser.addOption(QCommandLineOption("select-instance", "Instance the model parameters apply to, 0 by default.", "index"));
+    parser.addOption(QCommandLineOption("space", "Space to show: model, world, view, ndc or image.", "space"));
+    parser.addOption(QCommandLineOption("grid", "Grid to draw: lines or infinite.", "mode"));
+    parser.addOption(QCommandLineOption("split-view", "Show all five spaces at once."));
+}
+
+void SceneOptions::apply(const QCommandLineParser &parser, SceneRenderer &renderer)
+{
+    if (parser.isSet("vertex-format"))
+        renderer.setMeshPositionFormat(parsePositionFormat(parser.value("vertex-format")));
+
+    if (parser.isSet("instances"))
+    {
+        bool ok;
+        const unsigned count = parser.value("instances").toUInt(&ok);
+
+        if (!ok || count == 0)
+            throw std::runtime_error("Invalid value for --instances: " + parser.value("instances").toStdString());
+
+        renderer.setNumOfInstances(count);
+    }
+
+    if (parser.isSet("select-instance"))
+    {
+        bool ok;
+        const unsigned index = parser.value("select-instance").toUInt(&ok);
+
+        if (!ok || index >= renderer.numOfInstances())
+            throw std::runtime_error("Invalid value for --select-instance: " + parser.value("select-instance").toStdString());
+
+        renderer.selectInstance(index);
+    }
+
+    // All parameters in one go, so they are recalculated once. The model ones edit the selected instance.
+    SceneParameters parameters = renderer.parameters();
+    applyParameters(parser, parameters);
+    renderer.setParameters(parameters);
+
+    if (parser.isSet("space"))
+        renderer.setCurrentSpace(parseSpace(parser.value("space")));
+
+    if (parser.isSet("grid"))
+        renderer.setGridMode(parseGridMode(parser.value("grid")));
+
+    if (parser.isSet("split-view"))
+        renderer.setSplitView(true);
+}
+
+void SceneOptions::applyParameters(const QCommandLineParser &parser, SceneParameters &parameters)
+{
+    if (parser.isSet("model-scale"))
+        parameters.modelScale = parseVec3("model-scale", parser.value("model-scale"));
+
+    if (parser.isSet("model-rotate"))
+        parameters.modelRotate = parseVec3("model-rotate", parser.value("model-rotate"));
+
+    if (parser.isSet("model-translate"))
+        parameters.modelTranslate = parseVec3("model-translate", parser.value("model-translate"));
+
+    if (parser.isSet("view-position"))
+        parameters.viewPosition = parseVec3("view-position", parser.value("view-position"));
+
+    if (parser.isSet("view-target"))
+        parameters.viewTarget = parseVec3("view-target", parser.value("view-target"));
+
+    if (parser.isSet("view-up"))
+        parameters.viewUpVec = parseVec3("view-up", parser.value("view-up"));
+
+    if (parser.isSet("near"))
+        parameters.projectionNear = parseFloat("near", parser.value("near"));
+
+    if (parser.isSet("far"))
+        parameters.projectionFar = parseFloat("far", parser.value("far"));
+
+    if (parser.isSet("fov"))
+        parameters.projectionFov = parseFloat("fov", parser.value("fov"));
+}
+
+SceneRenderer::Space SceneOptions::parseSpace(const QString &name)
+{
+    const QString lower = name.toLower();
+
+    if (lower == "model" || lower == "0")
+        return SceneRenderer::Space::Model;
+    if (lower == "world" || lower == "1")
+        return SceneRenderer::Space::World;
+    if (lower == "view" || lower == "2")
+        return SceneRenderer::Space::View;
+    if (lower == "ndc" || lower == "3")
+        return SceneRenderer::Space::NDC;
+    if (lower == "image" || lower == "4")
+        return SceneRenderer::Space::RenderedImage;
+
+    throw std::runtime_error("Unknown space: " + name.toStdString());
+}
+
+GeometryArena::PositionFormat SceneOptions::parsePositionFormat(const QString &name)
+{
+    const QString lower = name.toLower();
+
+    if (lower == "float")
+        return GeometryArena::PositionFormat::Float;
+    if (lower == "half")
+        return GeometryArena::PositionFormat::HalfFloat;
+    if (lower == "snorm16")
+        return GeometryArena::PositionFormat::Snorm16;
+
+    throw std::runtime_error("Unknown vertex format: " + name.toStdString());
+}
+
+SceneRenderer::GridMode SceneOptions::parseGridMode(const QString &name)
+{
+    const QString lower = name.toLower();
+
+    if (lower == "lines")
+        return SceneRenderer::GridMode::Lines;
+    if (lower == "infinite")
+        return SceneRenderer::GridMode::Infinite;
+
+    throw std::runtime_error("Unknown grid mode: " + name.toStdString());
+}
+
+SceneRenderer::Backend SceneOptions::parseBackend(const QString &name)
+{
+    const QString lower = name.toLower();
+
+    if (lower == "opengl")
+        return SceneRenderer::Backend::OpenGL;
+    if (lower == "software")
+        return SceneRenderer::Backend::Software;
+
+    throw std::runtime_error("Unknown backend: " + name.toStdString());
+}
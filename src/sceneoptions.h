@@ -0,0 +1,26 @@
+#ifndef SCENEOPTIONS_H
+#define SCENEOPTIONS_H
+
+#include <QCommandLineParser>
+#include <QString>
+#include "scenerenderer.h"
+#include "sceneparameters.h"
+
+// Command line options for the scene parameters, used for headless rendering
+namespace SceneOptions
+{
+    void addOptions(QCommandLineParser &parser);
+
+    // Applies every option that is set to the renderer, throws on invalid values
+    void apply(const QCommandLineParser &parser, SceneRenderer &renderer);
+
+    // Same for only the transformation parameters
+    void applyParameters(const QCommandLineParser &parser, SceneParameters &parameters);
+
+    SceneRenderer::Space parseSpace(const QString &name);
+    GeometryArena::PositionFormat parsePositionFormat(const QString &name);
+    SceneRenderer::GridMode parseGridMode(const QString &name);
+    SceneRenderer::Backend parseBackend(const QString &name);
+}
+
+#endif // SCENEOPTIONS_H
@@ -0,0 +1,22 @@
+#ifndef SCENEPARAMETERS_H
+#define SCENEPARAMETERS_H
+
+#include <glm/glm.hpp>
+
+// The 21 transformation parameters of the scene, as set by the sliders
+struct SceneParameters
+{
+    glm::vec3 modelScale;
+    glm::vec3 modelRotate;
+    glm::vec3 modelTranslate;
+
+    glm::vec3 viewPosition;
+    glm::vec3 viewTarget;
+    glm::vec3 viewUpVec;
+
+    float projectionNear;
+    float projectionFar;
+    float projectionFov;
+};
+
+#endif // SCENEPARAMETERS_H
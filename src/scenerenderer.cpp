@@ -0,0 +1,1469 @@
+#include "scenerenderer.h"
+#include "meshloader.h"
+#include "meshsimplifier.h"
+#include "threadpool.h"
+#include <QElapsedTimer>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtx/rotate_vector.hpp>
+#include <iterator>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    // Camera position, near plane corners, far plane corners and again the near plane corners
+    const glm::vec3 frustumColours[] =
+    {
+        glm::vec3(0.50f, 0.50f, 0.50f),
+
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f),
+
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 0.0f),
+
+        glm::vec3(0.50f, 0.50f, 0.50f),
+        glm::vec3(0.50f, 0.50f, 0.50f),
+        glm::vec3(0.50f, 0.50f, 0.50f),
+        glm::vec3(0.50f, 0.50f, 0.50f),
+    };
+
+    const std::size_t numOfFrustumVertices = sizeof frustumColours / sizeof frustumColours[0];
+
+    // Lines from the near to the far plane, around both planes, and from the camera to the near plane
+    const std::uint32_t frustumIndices[] =
+    {
+        1, 5, 2, 6, 3, 7, 4, 8,
+        1, 2, 3, 4, 5, 6, 7, 8,
+        1, 4, 2, 3, 5, 8, 6, 7,
+        0, 9, 0, 10, 0, 11, 0, 12,
+    };
+
+    const std::size_t numOfFrustumIndices = sizeof frustumIndices / sizeof frustumIndices[0];
+
+    // Vertex stage of the shaders on the CPU, with the colours mixed towards a tint
+    void toClipSpace(const glm::mat4 &transform, const Mesh &mesh, const glm::vec3 &tint, float tintAmount, SoftwareRasterizer::Vertex *out)
+    {
+        ThreadPool::instance().parallelFor(mesh.numOfVertices(), 4096, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                out[i].position = transform * glm::vec4(mesh.positions[i], 1.0f);
+                out[i].colour = glm::mix(mesh.colours[i], tint, tintAmount);
+            }
+        });
+    }
+
+    void toClipSpace(const glm::mat4 &transform, const std::vector<GeometryArena::Vertex> &vertices, SoftwareRasterizer::Vertex *out)
+    {
+        ThreadPool::instance().parallelFor(vertices.size(), 4096, [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                out[i].position = transform * glm::vec4(vertices[i].position, 1.0f);
+                out[i].colour = vertices[i].colour;
+            }
+        });
+    }
+
+    // Simplified levels built at load time, smaller meshes are drawn as they are
+    const std::size_t maxNumOfMeshLods = 5;
+    const std::size_t minLodTriangles = 256;
+
+    // Clip space vertices the software backend transforms before handing them to the
+    // rasterizer, about 28 MB. Many instances of a large mesh go in chunks of this size.
+    const std::size_t maxSoftwareBatchVertices = std::size_t(1) << 20;
+}
+
+SceneRenderer::SceneRenderer(QObject *parent) :
+    QObject(parent), m_backend(Backend::OpenGL), m_modelScale(1.0f, 1.0f, 1.0f), m_viewPosition(10.0f, 10.0f, 10.0f), m_viewTarget(0.0f, 0.0f, 0.0f), m_viewUpVec(0.0f, 1.0f, 0.0f), m_currentSpace(Space::Model), m_gridMode(GridMode::Lines),
+    m_worldCameraPosition(10.0f, 10.0f, 10.0f), m_worldCameraTarget(0.0f, 0.0f, 0.0f), m_worldCameraUpVec(0.0f, 1.0f, 0.0f), m_projectionNear(0.1f), m_projectionFar(30.0f), m_projectionFov(90.0f),
+    m_shaderDirectory(":/res"), m_shaderReloadRequested(false), m_meshArena(GeometryArena::PositionFormat::Snorm16), m_meshPositionFormat(GeometryArena::PositionFormat::Snorm16),
+    m_gridGeometry(), m_yAxisGeometry(), m_frustumGeometry(), m_clippedSpace(), m_clippedGeometry(), m_meshLods(1, Mesh::cube()), m_currentMeshLod(0), m_meshPositions(PositionBuffer::fromPositions(m_meshLods.front().positions)),
+    m_instanceMatrices(1), m_selectedInstance(0), m_numOfVisibleInstances(0), m_splitView(false), m_aspect(1.0f), m_windowWidth(1), m_windowHeight(1), m_viewportWidth(1), m_viewportHeight(1), m_cameraBlockStride(0),
+    m_modelVersion(0), m_viewVersion(0), m_projectionVersion(0), m_worldCameraVersion(0), m_meshVersion(0), m_applyingState(false), m_dirtyFlags(AllDirty), m_changesThisFrame(0), m_changesLastFrame(0), m_recomputesThisFrame(0), m_recomputesLastFrame(0)
+{
+    const InstanceTransform transform = { m_modelScale, m_modelRotate, m_modelTranslate };
+    m_instances.push_back(transform);
+    m_appliedState.shaderReloads = 0;
+    m_appliedState.numOfChanges = 0;
+    m_appliedState = state();
+}
+
+SceneRenderer::~SceneRenderer()
+{
+
+}
+
+QSurfaceFormat SceneRenderer::surfaceFormat()
+{
+    // Set opengl version & profile
+    QSurfaceFormat format;
+
+    format.setRenderableType(QSurfaceFormat::OpenGL);
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    format.setSamples(4);
+
+    return format;
+}
+
+void SceneRenderer::initialize()
+{
+    // Nothing to set up on the GPU
+    if (m_backend == Backend::Software)
+    {
+        std::clog << "Renderer: software rasterizer on " << ThreadPool::instance().numOfThreads() << " threads\n" << std::endl;
+
+        initGridData();
+        markDirty(AllDirty);
+        return;
+    }
+
+    // Init opengl
+    bool success = initializeOpenGLFunctions();
+
+    // Check if opengl init was successfull
+    if (!success)
+        throw std::runtime_error("Could not load OpenGL functions.\nDo you have OpenGL v3.3? Otherwise use --backend software.");
+
+    // Print version info
+    std::clog << "OpenGL version: " << glGetString(GL_VERSION) <<
+                 "\nGLSL version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) <<
+                 "\nRenderer: " << glGetString(GL_RENDERER) <<
+                 "\nVendor: " << glGetString(GL_VENDOR) << '\n' << std::endl;
+
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClearDepth(1.0f);
+
+    // Enable face culling
+    glEnable(GL_CULL_FACE);
+    glFrontFace(GL_CW);
+    glCullFace(GL_BACK);
+
+    // Enable depth test
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_TRUE);
+    glDepthRange(0.0f, 1.0f);
+
+    // Init
+    initProgram();
+    initData();
+    m_profiler.initializeGpuTimers(this);
+
+    // Matrices are calculated before the first frame
+    markDirty(AllDirty);
+}
+
+void SceneRenderer::render()
+{
+    ScopedCpuTimer frameTimer(m_profiler, FrameProfiler::FrameCpu);
+
+    if (m_backend == Backend::Software)
+        renderSoftware();
+    else
+        renderOpenGL();
+
+    // Publish how many changes this frame took in, and how many recomputes they cost
+    if (m_changesThisFrame != m_changesLastFrame || m_recomputesThisFrame != m_recomputesLastFrame)
+    {
+        m_changesLastFrame = m_changesThisFrame;
+        m_recomputesLastFrame = m_recomputesThisFrame;
+        emit recomputesPerFrameChanged(m_changesLastFrame, m_recomputesLastFrame);
+    }
+
+    m_changesThisFrame = 0;
+    m_recomputesThisFrame = 0;
+}
+
+void SceneRenderer::renderOpenGL()
+{
+    m_profiler.beginGpuFrame();
+
+    // Shaders edited on disk, the old programs draw until the new ones are ready
+    if (m_shaderReloadRequested)
+    {
+        m_shaderReloadRequested = false;
+        m_shaders.startReload();
+    }
+
+    if (m_shaders.isReloading())
+        updateShaderReload();
+
+    // Recalculate everything that changed since the last frame
+    applyPendingChanges();
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glUseProgram(m_program);
+
+    // Every space on screen in its own viewport, with its own slot of the camera buffer
+    for (int i = 0; i < NumOfSpaces; ++i)
+    {
+        const Space space = static_cast<Space>(i);
+        if (!isOnScreen(space))
+            continue;
+
+        const glm::ivec4 viewport = viewportOf(space);
+        glViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+        glBindBufferRange(GL_UNIFORM_BUFFER, cameraBlockBinding, m_cameraUbo, m_cameraBlockStride * i, sizeof(CameraBlock));
+
+        drawSpace(space);
+    }
+
+    // Cleanup
+    glBindVertexArray(0);
+    glUseProgram(0);
+
+    m_profiler.endGpuFrame();
+}
+
+void SceneRenderer::renderSoftware()
+{
+    // There are no shaders to reload
+    m_shaderReloadRequested = false;
+
+    applyPendingChanges();
+
+    m_rasterizer.beginFrame(glm::vec3(1.0f, 1.0f, 1.0f));
+
+    for (int i = 0; i < NumOfSpaces; ++i)
+    {
+        const Space space = static_cast<Space>(i);
+        if (!isOnScreen(space))
+            continue;
+
+        const glm::ivec4 viewport = viewportOf(space);
+        m_rasterizer.setViewport(viewport.x, viewport.y, viewport.z, viewport.w);
+
+        drawSpaceSoftware(space);
+    }
+
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::RasterCpu);
+    m_rasterizer.endFrame();
+}
+
+void SceneRenderer::drawSpaceSoftware(Space space)
+{
+    // Same draws as drawSpace(), with the vertex stage of the shaders done here
+    const TransformChains &chains = m_transformChainsCache[static_cast<int>(space)].value();
+
+    const unsigned lod = selectMeshLod(space);
+    const Mesh &mesh = m_meshLods[lod];
+    if (space == m_currentSpace)
+        m_currentMeshLod = lod;
+
+    const std::size_t numOfVertices = mesh.numOfVertices();
+    const glm::vec3 white(1.0f, 1.0f, 1.0f);
+    const glm::vec3 red(1.0f, 0.0f, 0.0f);
+
+    // All instances (only where the model matrix is applied), like instanced.vert
+    if (m_instances.size() > 1 && (space == Space::World || space == Space::View || space == Space::RenderedImage))
+    {
+        const std::size_t count = space == Space::RenderedImage ? m_numOfVisibleInstances : m_instances.size();
+        const std::size_t selected = m_instanceSlots[m_selectedInstance];
+        const glm::mat4 &chain = chains.matrices[InstancesChain];
+
+        // The rasterizer copies what it needs, so one batch of instances at a time is enough
+        const std::size_t batchSize = std::max<std::size_t>(maxSoftwareBatchVertices / std::max<std::size_t>(numOfVertices, 1), 1);
+        m_clipVertices.resize(std::min(batchSize, count) * numOfVertices);
+
+        for (std::size_t first = 0; first < count; first += batchSize)
+        {
+            const std::size_t last = std::min(first + batchSize, count);
+
+            ThreadPool::instance().parallelFor(last - first, 64, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t slot = first + begin; slot < first + end; ++slot)
+                {
+                    const glm::mat4 transform = chain * m_orderedInstanceMatrices[slot];
+                    SoftwareRasterizer::Vertex *out = m_clipVertices.data() + (slot - first) * numOfVertices;
+
+                    for (std::size_t i = 0; i < numOfVertices; ++i)
+                    {
+                        glm::vec3 colour = slot == selected ? mesh.colours[i] : glm::mix(mesh.colours[i], white, 0.5f);
+                        if (slot >= m_numOfVisibleInstances)
+                            colour = glm::mix(colour, red, 0.6f);
+
+                        out[i].position = transform * glm::vec4(mesh.positions[i], 1.0f);
+                        out[i].colour = colour;
+                    }
+                }
+            });
+
+            for (std::size_t slot = first; slot < last; ++slot)
+                m_rasterizer.drawTriangles(m_clipVertices.data() + (slot - first) * numOfVertices, mesh.indices.data(), mesh.indices.size());
+        }
+    }
+
+    // Mesh (if not in ndc space, and not culled in the rendered image)
+    else if (space != Space::NDC)
+    {
+        const bool culled = m_numOfVisibleInstances == 0 && (space == Space::World || space == Space::View);
+
+        if (space != Space::RenderedImage || m_numOfVisibleInstances > 0)
+        {
+            m_clipVertices.resize(numOfVertices);
+            toClipSpace(chains.matrices[MeshChain], mesh, red, culled ? 0.6f : 0.0f, m_clipVertices.data());
+            m_rasterizer.drawTriangles(m_clipVertices.data(), mesh.indices.data(), mesh.indices.size());
+        }
+    }
+
+    // Clipped mesh in NDC (only in ndc space)
+    else
+    {
+        updateClippedMesh(lod);
+
+        const std::vector<GeometryArena::Vertex> &clipped = m_clipStage.vertices();
+        m_clipVertices.resize(clipped.size());
+        toClipSpace(chains.matrices[MeshChain], clipped, m_clipVertices.data());
+        m_rasterizer.drawTriangles(m_clipVertices.data(), m_clipStage.indices().data(), m_clipStage.indices().size());
+    }
+
+    // Grid, also in place of the infinite one
+    m_clipVertices.resize(m_gridVertices.size());
+    toClipSpace(chains.matrices[GridChain], m_gridVertices, m_clipVertices.data());
+    m_rasterizer.drawLines(m_clipVertices.data(), m_gridIndices.data(), m_gridIndices.size());
+
+    // Frustum (only in world space & view space)
+    if (space == Space::World || space == Space::View)
+    {
+        const FrustumVertices &frustum = m_frustumCache.value();
+        m_clipVertices.resize(frustum.size());
+        toClipSpace(chains.matrices[FrustumChain], frustum, m_clipVertices.data());
+        m_rasterizer.drawLines(m_clipVertices.data(), frustumIndices, numOfFrustumIndices);
+    }
+}
+
+void SceneRenderer::drawSpace(Space space)
+{
+    glBindVertexArray(m_meshArena.vao());
+
+    // Less detail the smaller the mesh ends up on screen
+    const unsigned lod = selectMeshLod(space);
+    const GeometryArena::Range &meshGeometry = m_meshGeometry[lod];
+    if (space == m_currentSpace)
+        m_currentMeshLod = lod;
+
+    // Draw all instances at once (only where the model matrix is applied)
+    if (m_instances.size() > 1 && (space == Space::World || space == Space::View || space == Space::RenderedImage))
+    {
+        // The rendered image only gets the visible instances, the other spaces show the culled ones tinted
+        const std::size_t count = space == Space::RenderedImage ? m_numOfVisibleInstances : m_instances.size();
+
+        glUseProgram(m_instancedProgram);
+        m_meshArena.drawInstanced(GL_TRIANGLES, meshGeometry, static_cast<GLsizei>(count));
+        glUseProgram(m_program);
+    }
+
+    // Draw mesh (if not in ndc space, and not culled in the rendered image)
+    else if (space != Space::NDC)
+    {
+        const bool culled = m_numOfVisibleInstances == 0 && (space == Space::World || space == Space::View);
+
+        if (space != Space::RenderedImage || m_numOfVisibleInstances > 0)
+        {
+            glUniform1i(m_transformChainUnif, MeshChain);
+            glUniform1i(m_culledUnif, culled);
+            m_meshArena.draw(GL_TRIANGLES, meshGeometry);
+            glUniform1i(m_culledUnif, false);
+        }
+    }
+
+    // Draw the clipped mesh in NDC (only in ndc space)
+    else
+    {
+        updateClippedMesh(lod);
+
+        glBindVertexArray(m_helperArena.vao());
+        glUniform1i(m_transformChainUnif, MeshChain);
+        m_helperArena.draw(GL_TRIANGLES, m_clippedGeometry);
+    }
+
+    // Helper geometry shares the other vao
+    glBindVertexArray(m_helperArena.vao());
+
+    // Draw grid
+    if (m_gridMode == GridMode::Infinite)
+    {
+        // One full-screen triangle, blended as its lines fade out
+        glUseProgram(m_gridProgram);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glDisable(GL_BLEND);
+        glUseProgram(m_program);
+
+        // The y-axis is not on the plane
+        glUniform1i(m_transformChainUnif, GridChain);
+        m_helperArena.draw(GL_LINES, m_yAxisGeometry);
+    }
+    else
+    {
+        glUniform1i(m_transformChainUnif, GridChain);
+        m_helperArena.draw(GL_LINES, m_gridGeometry);
+    }
+
+    // Draw frustum (only in world space & view space)
+    if (space == Space::World || space == Space::View)
+    {
+        glUniform1i(m_transformChainUnif, FrustumChain);
+        m_helperArena.draw(GL_LINES, m_frustumGeometry);
+    }
+}
+
+void SceneRenderer::resize(int w, int h)
+{
+    m_windowWidth = w;
+    m_windowHeight = h;
+
+    if (m_backend == Backend::Software)
+        m_rasterizer.resize(w, h);
+
+    updateViewportSize();
+}
+
+void SceneRenderer::setSplitView(bool split)
+{
+    if (split == m_splitView)
+        return;
+
+    m_splitView = split;
+    updateViewportSize();
+    emit splitViewChanged(m_splitView);
+    markDirty(SpaceDirty);
+}
+
+void SceneRenderer::updateViewportSize()
+{
+    // Split view: 3 columns and 2 rows
+    m_viewportWidth = std::max(m_splitView ? m_windowWidth / 3 : m_windowWidth, 1);
+    m_viewportHeight = std::max(m_splitView ? m_windowHeight / 2 : m_windowHeight, 1);
+
+    // Adjust perspective matrices, the world camera has one too
+    m_aspect = static_cast<float>(m_viewportWidth) / m_viewportHeight;
+    markDirty(ProjectionDirty | CameraDirty);
+}
+
+glm::ivec4 SceneRenderer::viewportOf(Space space, int windowWidth, int windowHeight, bool splitView)
+{
+    if (!splitView)
+        return glm::ivec4(0, 0, windowWidth, windowHeight);
+
+    // Model, World and View on the top row, NDC and the rendered image below them
+    const int width = std::max(windowWidth / 3, 1);
+    const int height = std::max(windowHeight / 2, 1);
+    const int index = static_cast<int>(space);
+    const int column = index % 3;
+    const int row = index / 3;
+
+    return glm::ivec4(column * width, (1 - row) * height, width, height);
+}
+
+void SceneRenderer::initProgram()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_shaders.initialize(this, ShaderManager::defaultCacheDirectory());
+
+    // Built together, so they can compile in parallel
+    const std::string &dir = m_shaderDirectory;
+    m_programId = m_shaders.add(dir + "/shader.vert", dir + "/shader.frag");
+    m_instancedProgramId = m_shaders.add(dir + "/instanced.vert", dir + "/shader.frag");
+    m_gridProgramId = m_shaders.add(dir + "/grid.vert", dir + "/grid.frag");
+    m_shaders.build();
+
+    std::clog << "Shaders built in " << timer.elapsed() << " ms (" << m_shaders.numOfCachedPrograms() << " of 3 programs cached)\n" << std::endl;
+
+    useBuiltPrograms();
+}
+
+void SceneRenderer::useBuiltPrograms()
+{
+    m_program = m_shaders.program(m_programId);
+    m_instancedProgram = m_shaders.program(m_instancedProgramId);
+    m_gridProgram = m_shaders.program(m_gridProgramId);
+
+    // All programs read their matrices from the same camera block
+    bindCameraBlock(m_program);
+    bindCameraBlock(m_instancedProgram);
+    bindCameraBlock(m_gridProgram);
+
+    // Load uniforms
+    m_transformChainUnif = glGetUniformLocation(m_program, "transformChain");
+    m_culledUnif = glGetUniformLocation(m_program, "culled");
+
+    // The grid always uses the same chain
+    m_gridTransformChainUnif = glGetUniformLocation(m_gridProgram, "transformChain");
+    glUseProgram(m_gridProgram);
+    glUniform1i(m_gridTransformChainUnif, GridChain);
+    glUseProgram(0);
+}
+
+void SceneRenderer::updateShaderReload()
+{
+    switch (m_shaders.pollReload())
+    {
+    case ShaderManager::ReloadStatus::Pending:
+        // Check again next frame
+        emit updateRequested();
+        break;
+
+    case ShaderManager::ReloadStatus::Succeeded:
+        try
+        {
+            useBuiltPrograms();
+            emit shaderErrorChanged(QString());
+        }
+        catch (const std::exception &e)
+        {
+            // Linked, but without the camera block
+            emit shaderErrorChanged(QString::fromStdString(e.what()));
+        }
+        break;
+
+    case ShaderManager::ReloadStatus::Failed:
+        emit shaderErrorChanged(QString::fromStdString(m_shaders.reloadError()));
+        break;
+
+    default:
+        break;
+    }
+}
+
+void SceneRenderer::bindCameraBlock(GLuint program)
+{
+    const GLuint blockIndex = glGetUniformBlockIndex(program, "Camera");
+    if (blockIndex == GL_INVALID_INDEX)
+        throw std::runtime_error("Program has no Camera uniform block");
+
+    glUniformBlockBinding(program, blockIndex, cameraBlockBinding);
+}
+
+void SceneRenderer::setMeshPositionFormat(GeometryArena::PositionFormat format)
+{
+    m_meshPositionFormat = format;
+    markDirty(MeshDirty);
+}
+
+void SceneRenderer::loadMesh(const std::string &path)
+{
+    QElapsedTimer timer;
+    Mesh mesh = MeshLoader::load(path);
+
+    timer.start();
+    m_meshLods = MeshSimplifier::buildLods(std::move(mesh), maxNumOfMeshLods, minLodTriangles);
+
+    // Print simplification info
+    std::clog << "Levels of detail:";
+    for (const Mesh &lod : m_meshLods)
+        std::clog << ' ' << lod.numOfTriangles();
+    std::clog << " triangles\nSimplification time: " << timer.elapsed() << " ms" << '\n' << std::endl;
+
+    m_meshPositions = PositionBuffer::fromPositions(m_meshLods.front().positions);
+    ++m_meshVersion;
+    markDirty(MeshDirty);
+}
+
+void SceneRenderer::initData()
+{
+    // The helper geometry spans the whole scene and keeps full float positions,
+    // the mesh arena grows for larger meshes. The clipped mesh goes after the
+    // helper geometry once NDC space is shown.
+    m_helperArena.initialize(this, 128, 128);
+    m_meshArena.initialize(this, 1024, 1024);
+
+    initCameraData();
+    initMeshData();
+    initGridData();
+    initFrustumData();
+}
+
+void SceneRenderer::initCameraData()
+{
+    // One slot per space, at offsets the driver can bind
+    GLint alignment;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_cameraBlockStride = (sizeof(CameraBlock) + alignment - 1) / alignment * alignment;
+    m_cameraData.assign(m_cameraBlockStride * NumOfSpaces, 0);
+
+    glGenBuffers(1, &m_cameraUbo);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUbo);
+    glBufferData(GL_UNIFORM_BUFFER, m_cameraData.size(), nullptr, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SceneRenderer::updateCameraData()
+{
+    // Orphan the old storage so the driver never waits for frames still using it
+    glBindBuffer(GL_UNIFORM_BUFFER, m_cameraUbo);
+    glBufferData(GL_UNIFORM_BUFFER, m_cameraData.size(), nullptr, GL_STREAM_DRAW);
+
+    // Only the slots on screen are read
+    if (m_splitView)
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, m_cameraData.size(), m_cameraData.data());
+    }
+    else
+    {
+        const std::size_t offset = m_cameraBlockStride * static_cast<int>(m_currentSpace);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(CameraBlock), m_cameraData.data() + offset);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SceneRenderer::updateFrustumData()
+{
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::FrustumDataCpu);
+
+    // Only the projection parameters shape the frustum
+    if (m_frustumCache.update({{m_projectionVersion}}, [this]() { return calcFrustumVertices(); }) && m_backend == Backend::OpenGL)
+        m_helperArena.update(m_frustumGeometry, m_frustumCache.value());
+}
+
+void SceneRenderer::updateClippedMesh(unsigned lod)
+{
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::ClipCpu);
+
+    // Created vertices are highlighted in magenta
+    const glm::mat4 mvp = m_projectionMatrix * m_viewMatrix * m_modelMatrix;
+    const bool clipped = m_clipStage.update({{m_meshVersion, lod, m_modelVersion, m_viewVersion, m_projectionVersion}},
+                                            m_meshLods[lod], mvp, glm::vec3(1.0f, 0.0f, 1.0f));
+
+    if (!clipped || m_backend == Backend::Software)
+        return;
+
+    const std::vector<GeometryArena::Vertex> &vertices = m_clipStage.vertices();
+    const std::vector<std::uint32_t> &indices = m_clipStage.indices();
+
+    // Rewritten in place, the range only moves when it has to grow. It is the last one
+    // in the helper arena, so growing hands its space back before taking more.
+    if (static_cast<GLsizei>(vertices.size()) > m_clippedSpace.numOfVertices || static_cast<GLsizei>(indices.size()) > m_clippedSpace.numOfIndices)
+    {
+        m_helperArena.release(m_clippedSpace);
+        m_clippedSpace = m_helperArena.allocate(std::max(static_cast<GLsizei>(vertices.size()), 2 * m_clippedSpace.numOfVertices),
+                                                std::max(static_cast<GLsizei>(indices.size()), 2 * m_clippedSpace.numOfIndices));
+    }
+
+    m_clippedGeometry = m_helperArena.update(m_clippedSpace, vertices, indices);
+}
+
+SceneRenderer::FrustumVertices SceneRenderer::calcFrustumVertices() const
+{
+    const float nearPlane = -m_projectionNear;
+    const float farPlane = -m_projectionFar;
+    const float height = 2 * nearPlane * tan(glm::radians(m_projectionFov / 2.0f));
+    const float width = height * m_aspect;
+
+    const float leftNear = -width / 2.0f;
+    const float rightNear = width / 2.0f;
+    const float bottomNear = -height / 2.0f;
+    const float topNear = height / 2.0f;
+
+    const float leftFar = leftNear * farPlane / nearPlane;
+    const float rightFar = rightNear * farPlane / nearPlane;
+    const float bottomFar = bottomNear * farPlane / nearPlane;
+    const float topFar = topNear * farPlane / nearPlane;
+
+    const glm::vec3 positions[] =
+    {
+        glm::vec3(0.0f, 0.0f, 0.0f),
+
+        glm::vec3(leftNear, topNear, nearPlane),
+        glm::vec3(rightNear, topNear, nearPlane),
+        glm::vec3(rightNear, bottomNear, nearPlane),
+        glm::vec3(leftNear, bottomNear, nearPlane),
+
+        glm::vec3(leftFar, topFar, farPlane),
+        glm::vec3(rightFar, topFar, farPlane),
+        glm::vec3(rightFar, bottomFar, farPlane),
+        glm::vec3(leftFar, bottomFar, farPlane),
+
+        glm::vec3(leftNear, topNear, nearPlane),
+        glm::vec3(rightNear, topNear, nearPlane),
+        glm::vec3(rightNear, bottomNear, nearPlane),
+        glm::vec3(leftNear, bottomNear, nearPlane),
+    };
+
+    FrustumVertices vertices(numOfFrustumVertices);
+    for (std::size_t i = 0; i < numOfFrustumVertices; ++i)
+    {
+        vertices[i].position = positions[i];
+        vertices[i].colour = frustumColours[i];
+    }
+
+    return vertices;
+}
+
+void SceneRenderer::initFrustumData()
+{
+    const std::vector<std::uint32_t> indices(frustumIndices, frustumIndices + numOfFrustumIndices);
+
+    // The positions are filled in once the projection is known
+    m_frustumGeometry = m_helperArena.allocate(FrustumVertices(numOfFrustumVertices), indices);
+}
+
+void SceneRenderer::initGridData()
+{
+    // Grid constants
+    const int size = 20;
+    const float delta = 1.0f;
+
+    // Data
+    std::vector<GLfloat> vertices;
+    std::vector<GLfloat> colours;
+
+    // z-aligned line end points
+    for (int x = -size/2; x <= size/2; x += delta)
+    {
+        // vertices
+        vertices.push_back(x);
+        vertices.push_back(0);
+        vertices.push_back(delta * size / 2.0f);
+
+        vertices.push_back(x);
+        vertices.push_back(0);
+        vertices.push_back(- delta * size / 2.0f);
+
+        // colours
+        if (x != 0)
+        {
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+        }
+        else // z-axis
+        {
+            colours.push_back(0.0f);
+            colours.push_back(0.0f);
+            colours.push_back(1.0f);
+
+            colours.push_back(0.0f);
+            colours.push_back(0.0f);
+            colours.push_back(1.0f);
+        }
+    }
+
+    // x-aligned line end points
+    for (int z = -size/2; z <= size/2; z += delta)
+    {
+        // vertices
+        vertices.push_back(delta * size / 2.0f);
+        vertices.push_back(0);
+        vertices.push_back(z);
+
+        vertices.push_back(- delta * size / 2.0f);
+        vertices.push_back(0);
+        vertices.push_back(z);
+
+        // colours
+        if (z != 0)
+        {
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+            colours.push_back(0.75f);
+        }
+        else // x-axis
+        {
+            colours.push_back(1.0f);
+            colours.push_back(0.0f);
+            colours.push_back(0.0f);
+
+            colours.push_back(1.0f);
+            colours.push_back(0.0f);
+            colours.push_back(0.0f);
+        }
+    }
+
+    // y-axis vertices
+    vertices.push_back(0);
+    vertices.push_back(size / 2.0f);
+    vertices.push_back(0);
+
+    vertices.push_back(0);
+    vertices.push_back(- size / 2.0f);
+    vertices.push_back(0);
+
+    // y-axis colours
+    colours.push_back(0.0f);
+    colours.push_back(1.0f);
+    colours.push_back(0.0f);
+
+    colours.push_back(0.0f);
+    colours.push_back(1.0f);
+    colours.push_back(0.0f);
+
+    // Interleave and draw the lines in order, kept for the software backend
+    m_gridVertices.resize(vertices.size() / 3);
+    m_gridIndices.resize(m_gridVertices.size());
+
+    for (std::size_t i = 0; i < m_gridVertices.size(); ++i)
+    {
+        m_gridVertices[i].position = glm::vec3(vertices[3 * i], vertices[3 * i + 1], vertices[3 * i + 2]);
+        m_gridVertices[i].colour = glm::vec3(colours[3 * i], colours[3 * i + 1], colours[3 * i + 2]);
+        m_gridIndices[i] = static_cast<std::uint32_t>(i);
+    }
+
+    if (m_backend == Backend::Software)
+        return;
+
+    m_gridGeometry = m_helperArena.allocate(m_gridVertices, m_gridIndices);
+
+    // The last line, drawn on its own next to the infinite grid
+    m_yAxisGeometry = m_gridGeometry;
+    m_yAxisGeometry.firstIndex += static_cast<GLsizeiptr>(sizeof(std::uint32_t)) * (m_gridGeometry.numOfIndices - 2);
+    m_yAxisGeometry.numOfIndices = 2;
+}
+
+void SceneRenderer::initMeshData()
+{
+    glBindVertexArray(m_meshArena.vao());
+
+    // Create and bind instance vbo
+    glGenBuffers(1, &m_instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+
+    // Model matrix attrib, one column per location, advancing once per instance
+    for (GLuint column = 0; column < 4; ++column)
+    {
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), reinterpret_cast<void*>(sizeof(glm::vec4) * column));
+        glVertexAttribDivisor(2 + column, 1);
+    }
+
+    // Cleanup
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The mesh itself is uploaded before the first frame
+}
+
+void SceneRenderer::updateMeshData()
+{
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::MeshDataCpu);
+
+    // The software backend draws the levels of detail as they are
+    m_currentMeshLod = std::min(m_currentMeshLod, static_cast<unsigned>(m_meshLods.size() - 1));
+    if (m_backend == Backend::Software)
+        return;
+
+    // The arena only holds the mesh, a new format drops the old one with everything else
+    if (m_meshArena.positionFormat() != m_meshPositionFormat)
+        m_meshArena.setPositionFormat(m_meshPositionFormat);
+    else
+        for (auto it = m_meshGeometry.rbegin(); it != m_meshGeometry.rend(); ++it)
+            m_meshArena.release(*it);
+
+    // All levels of detail live next to each other, switching is only a different draw range
+    m_meshGeometry.clear();
+    std::vector<GeometryArena::Vertex> vertices;
+    for (const Mesh &lod : m_meshLods)
+    {
+        vertices.resize(lod.numOfVertices());
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            vertices[i].position = lod.positions[i];
+            vertices[i].colour = lod.colours[i];
+        }
+
+        m_meshGeometry.push_back(m_meshArena.allocate(vertices, lod.indices));
+    }
+}
+
+unsigned SceneRenderer::selectMeshLod(Space space) const
+{
+    // NDC space draws the clipped mesh, already in NDC, so the mesh chain says nothing about its size there
+    if (m_meshLods.size() == 1 || space == Space::NDC)
+        return 0;
+
+    const TransformChains &chains = m_transformChainsCache[static_cast<int>(space)].value();
+
+    // All instances share one draw call and so one level: the finest any of them needs, so
+    // none is drawn coarser than its size on screen allows. Far ones get that detail as well.
+    if (m_instances.size() > 1 && (space == Space::World || space == Space::View || space == Space::RenderedImage))
+    {
+        const std::size_t count = space == Space::RenderedImage ? m_numOfVisibleInstances : m_instances.size();
+        unsigned lod = static_cast<unsigned>(m_meshLods.size() - 1);
+
+        for (std::size_t slot = 0; slot < count && lod > 0; ++slot)
+            lod = std::min(lod, meshLodOf(chains.matrices[InstancesChain] * m_orderedInstanceMatrices[slot]));
+
+        return lod;
+    }
+
+    return meshLodOf(chains.matrices[MeshChain]);
+}
+
+unsigned SceneRenderer::meshLodOf(const glm::mat4 &transform) const
+{
+    // Project the [-1, 1] bounding cube of the mesh with its transform to clip space
+    glm::vec2 min(std::numeric_limits<float>::max());
+    glm::vec2 max(-std::numeric_limits<float>::max());
+
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const glm::vec4 position(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f, 1.0f);
+        const glm::vec4 clip = transform * position;
+
+        // Reaches behind the camera, the mesh can be arbitrarily large on screen
+        if (clip.w <= 0.0f)
+            return 0;
+
+        const glm::vec2 ndc = glm::vec2(clip.x, clip.y) / clip.w;
+        min = glm::min(min, ndc);
+        max = glm::max(max, ndc);
+    }
+
+    // Size in pixels of the projected bounding box
+    const float size = std::max((max.x - min.x) * 0.5f * m_viewportWidth, (max.y - min.y) * 0.5f * m_viewportHeight);
+
+    // Full detail when the mesh fills half the viewport. Every level has a quarter of the
+    // triangles, so halving the size on screen keeps the number of triangles per pixel.
+    const float fullDetailSize = 0.5f * std::max(m_viewportWidth, m_viewportHeight);
+    if (size >= fullDetailSize)
+        return 0;
+
+    const float level = std::floor(std::log2(fullDetailSize / std::max(size, 1.0f)));
+    return std::min(static_cast<unsigned>(level), static_cast<unsigned>(m_meshLods.size() - 1));
+}
+
+void SceneRenderer::updateInstanceData()
+{
+    // Stored in draw order, visible instances first
+    m_orderedInstanceMatrices.resize(m_instanceOrder.size());
+    for (std::size_t slot = 0; slot < m_instanceOrder.size(); ++slot)
+        m_orderedInstanceMatrices[slot] = m_instanceMatrices[m_instanceOrder[slot]];
+
+    if (m_backend == Backend::Software)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * m_orderedInstanceMatrices.size(), m_orderedInstanceMatrices.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneRenderer::updateSelectedInstanceData()
+{
+    const std::uint32_t slot = m_instanceSlots[m_selectedInstance];
+    m_orderedInstanceMatrices[slot] = m_instanceMatrices[m_selectedInstance];
+
+    if (m_backend == Backend::Software)
+        return;
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceVbo);
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * slot, sizeof(glm::mat4), &m_orderedInstanceMatrices[slot]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool SceneRenderer::cullInstances()
+{
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::CullingCpu);
+
+    // Against the frustum of the view camera, the one drawn in world & view space
+    const Frustum frustum = Frustum::fromMatrix(m_projectionMatrix * m_viewMatrix);
+
+    m_nextInstanceOrder.clear();
+    m_culledInstances.clear();
+    m_instanceBvh.cull(frustum, m_nextInstanceOrder, m_culledInstances);
+
+    const unsigned numOfVisible = static_cast<unsigned>(m_nextInstanceOrder.size());
+    m_nextInstanceOrder.insert(m_nextInstanceOrder.end(), m_culledInstances.begin(), m_culledInstances.end());
+
+    // Moving the camera mostly keeps the same instances in view, then the buffer stays as it is
+    if (numOfVisible == m_numOfVisibleInstances && m_nextInstanceOrder == m_instanceOrder)
+        return false;
+
+    m_instanceOrder.swap(m_nextInstanceOrder);
+    m_numOfVisibleInstances = numOfVisible;
+
+    m_instanceSlots.resize(m_instanceOrder.size());
+    for (std::size_t slot = 0; slot < m_instanceOrder.size(); ++slot)
+        m_instanceSlots[m_instanceOrder[slot]] = static_cast<std::uint32_t>(slot);
+
+    return true;
+}
+
+void SceneRenderer::setNumOfInstances(unsigned count)
+{
+    if (count < 1)
+        count = 1;
+
+    if (count == m_instances.size())
+        return;
+
+    // Keep the selected instance, it becomes the first one
+    storeSelectedInstance();
+    const InstanceTransform selected = m_instances[m_selectedInstance];
+    m_instances.assign(1, selected);
+    m_selectedInstance = 0;
+
+    // Lay the others out on a square grid around the origin, skipping its centre
+    const int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count)))) | 1;
+    const float spacing = 3.0f;
+
+    for (int cell = 0; m_instances.size() < count; ++cell)
+    {
+        const int col = cell % side - side / 2;
+        const int row = cell / side - side / 2;
+        if (col == 0 && row == 0)
+            continue;
+
+        // Vary the orientation a bit so the instances are told apart
+        InstanceTransform transform;
+        transform.scale = glm::vec3(1.0f, 1.0f, 1.0f);
+        transform.rotate = glm::vec3((cell * 37) % 360, (cell * 53) % 360, 0.0f);
+        transform.translate = glm::vec3(col * spacing, 0.0f, row * spacing);
+        m_instances.push_back(transform);
+    }
+
+    m_instanceMatrices.resize(m_instances.size());
+    for (std::size_t i = 0; i < m_instances.size(); ++i)
+        m_instanceMatrices[i] = composeModelMatrix(m_instances[i]);
+
+    markDirty(InstancesDirty | CameraDirty);
+}
+
+void SceneRenderer::selectInstance(unsigned index)
+{
+    if (index >= m_instances.size() || index == m_selectedInstance)
+        return;
+
+    // The previous selection keeps its edits, even when no frame showed them yet
+    const bool stored = storeSelectedInstance();
+
+    // The model parameters now edit the new selection
+    m_selectedInstance = index;
+    m_modelScale = m_instances[index].scale;
+    m_modelRotate = m_instances[index].rotate;
+    m_modelTranslate = m_instances[index].translate;
+    markDirty(stored ? ModelDirty | InstancesDirty : ModelDirty);
+
+    emit instanceSelected(index, parameters());
+}
+
+bool SceneRenderer::storeSelectedInstance()
+{
+    InstanceTransform &selected = m_instances[m_selectedInstance];
+    if (selected.scale == m_modelScale && selected.rotate == m_modelRotate && selected.translate == m_modelTranslate)
+        return false;
+
+    selected.scale = m_modelScale;
+    selected.rotate = m_modelRotate;
+    selected.translate = m_modelTranslate;
+    m_instanceMatrices[m_selectedInstance] = composeModelMatrix(selected);
+    return true;
+}
+
+glm::mat4 SceneRenderer::composeModelMatrix(const InstanceTransform &transform)
+{
+    glm::mat4 matrix;
+    matrix *= glm::translate(glm::mat4(), transform.translate);
+    matrix *= glm::rotate(glm::mat4(), glm::radians(transform.rotate.z), glm::vec3(0, 0, 1));
+    matrix *= glm::rotate(glm::mat4(), glm::radians(transform.rotate.y), glm::vec3(0, 1, 0));
+    matrix *= glm::rotate(glm::mat4(), glm::radians(transform.rotate.x), glm::vec3(1, 0, 0));
+    matrix *= glm::scale(glm::mat4(), transform.scale);
+    return matrix;
+}
+
+void SceneRenderer::recalcModelMatrix()
+{
+    InstanceTransform &selected = m_instances[m_selectedInstance];
+    selected.scale = m_modelScale;
+    selected.rotate = m_modelRotate;
+    selected.translate = m_modelTranslate;
+
+    m_modelMatrix = composeModelMatrix(selected);
+    ++m_modelVersion;
+    m_instanceMatrices[m_selectedInstance] = m_modelMatrix;
+
+    emit modelMatrixChanged(m_modelMatrix);
+}
+
+void SceneRenderer::recalcViewMatrix()
+{
+    m_viewMatrix = glm::lookAt(m_viewPosition, m_viewTarget, m_viewUpVec);
+    ++m_viewVersion;
+    emit viewMatrixChanged(m_viewMatrix);
+}
+
+void SceneRenderer::recalcProjectionMatrix()
+{
+    m_projectionMatrix = glm::perspective(glm::radians(m_projectionFov), m_aspect, m_projectionNear, m_projectionFar);
+    ++m_projectionVersion;
+    emit projectionMatrixChanged(m_projectionMatrix);
+}
+
+void SceneRenderer::applyPendingChanges()
+{
+    if (!m_dirtyFlags)
+        return;
+
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::RecomputeCpu);
+
+    if (m_dirtyFlags & MeshDirty)
+        updateMeshData();
+
+    if (m_dirtyFlags & ModelDirty)
+        recalcModelMatrix();
+
+    if (m_dirtyFlags & ViewDirty)
+        recalcViewMatrix();
+
+    if (m_dirtyFlags & ProjectionDirty)
+        recalcProjectionMatrix();
+
+    if (m_dirtyFlags & CameraDirty)
+        ++m_worldCameraVersion;
+
+    updateFrustumData();
+
+    // Bounds of the instances, only the selected one moves when the model parameters change
+    if (m_dirtyFlags & InstancesDirty)
+    {
+        std::vector<Aabb> bounds(m_instanceMatrices.size());
+        std::transform(m_instanceMatrices.begin(), m_instanceMatrices.end(), bounds.begin(), &Aabb::ofUnitCube);
+        m_instanceBvh.build(bounds);
+    }
+    else if (m_dirtyFlags & ModelDirty)
+        m_instanceBvh.refit(m_selectedInstance, Aabb::ofUnitCube(m_modelMatrix));
+
+    bool reordered = false;
+    if (m_dirtyFlags & (InstancesDirty | ModelDirty | ViewDirty | ProjectionDirty))
+        reordered = cullInstances();
+
+    // Only the selected instance changes when the model parameters do
+    if (m_dirtyFlags & InstancesDirty || reordered)
+        updateInstanceData();
+    else if (m_dirtyFlags & ModelDirty)
+        updateSelectedInstanceData();
+
+    // Every change ends up in the mvp matrices, so these are rebuilt once
+    updateMvpMatrix();
+
+    m_dirtyFlags = 0;
+}
+
+void SceneRenderer::updateMvpMatrix()
+{
+    ScopedCpuTimer timer(m_profiler, FrameProfiler::MvpMatrixCpu);
+
+    m_worldCameraCache.update({{m_worldCameraVersion}}, [this]() -> glm::mat4 {
+        const glm::mat4 view = glm::lookAt(m_worldCameraPosition, m_worldCameraTarget, m_worldCameraUpVec);
+        const glm::mat4 perspective = glm::perspective(glm::radians(90.0f), m_aspect, 0.1f, 200.0f);
+        return perspective * view;
+    });
+
+    m_inverseViewCache.update({{m_viewVersion}}, [this]() { return glm::inverse(m_viewMatrix); });
+
+    m_camera.selectedInstance = static_cast<GLint>(m_instanceSlots[m_selectedInstance]);
+    m_camera.numOfVisibleInstances = static_cast<GLint>(m_numOfVisibleInstances);
+
+    // The slots of the spaces on screen only differ in their transform chains
+    for (int i = 0; i < NumOfSpaces; ++i)
+    {
+        const Space space = static_cast<Space>(i);
+        if (!isOnScreen(space))
+            continue;
+
+        CachedValue<TransformChains, 4> &chainsCache = m_transformChainsCache[i];
+        chainsCache.update(chainVersions(space), [this, space]() { return calcTransformChains(space); });
+
+        // The software backend reads the chains from the cache
+        if (m_backend == Backend::Software)
+            continue;
+
+        const TransformChains &chains = chainsCache.value();
+        std::copy(chains.matrices, chains.matrices + NumOfChains, m_camera.transformChains);
+        std::memcpy(m_cameraData.data() + m_cameraBlockStride * i, &m_camera, sizeof m_camera);
+    }
+
+    // One upload for all programs
+    if (m_backend == Backend::OpenGL)
+        updateCameraData();
+
+    ++m_recomputesThisFrame;
+}
+
+CachedValue<SceneRenderer::TransformChains, 4>::Versions SceneRenderer::chainVersions(Space space) const
+{
+    // Inputs of the transform chains of a space, 0 for the ones it does not use
+    switch (space)
+    {
+    case Space::RenderedImage:
+        return {{m_modelVersion, m_viewVersion, m_projectionVersion, 0}};
+    case Space::NDC:
+    case Space::Model:
+        return {{0, m_viewVersion, 0, m_worldCameraVersion}};
+    case Space::View:
+    case Space::World:
+        return {{m_modelVersion, m_viewVersion, 0, m_worldCameraVersion}};
+    default:
+        throw std::runtime_error("Unknown space");
+    }
+}
+
+SceneRenderer::TransformChains SceneRenderer::calcTransformChains(Space space) const
+{
+    const glm::mat4 &worldCamera = m_worldCameraCache.value();
+    const glm::mat4 &inverseView = m_inverseViewCache.value();
+
+    TransformChains chains;
+    glm::mat4 *matrices = chains.matrices;
+
+    switch (space)
+    {
+    case Space::RenderedImage:
+        matrices[GridChain] = m_projectionMatrix * m_viewMatrix;
+        matrices[InstancesChain] = m_projectionMatrix * m_viewMatrix;
+        matrices[MeshChain] = matrices[InstancesChain] * m_modelMatrix;
+        matrices[FrustumChain] = m_projectionMatrix * m_viewMatrix * inverseView;
+        break;
+
+    case Space::NDC:
+        matrices[GridChain] = worldCamera;
+        matrices[MeshChain] = worldCamera;
+        matrices[FrustumChain] = worldCamera * inverseView;
+        break;
+
+    case Space::View:
+        matrices[GridChain] = worldCamera;
+        matrices[InstancesChain] = worldCamera * m_viewMatrix;
+        matrices[MeshChain] = matrices[InstancesChain] * m_modelMatrix;
+        matrices[FrustumChain] = worldCamera;
+        break;
+
+    case Space::World:
+        matrices[GridChain] = worldCamera;
+        matrices[InstancesChain] = worldCamera;
+        matrices[MeshChain] = worldCamera * m_modelMatrix;
+        matrices[FrustumChain] = worldCamera * inverseView;
+        break;
+
+    case Space::Model:
+        matrices[GridChain] = worldCamera;
+        matrices[MeshChain] = worldCamera;
+        matrices[FrustumChain] = worldCamera * inverseView;
+        break;
+
+    default:
+        throw std::runtime_error("Unknown space");
+    }
+
+    return chains;
+}
+
+CacheStats SceneRenderer::matrixCacheStats() const
+{
+    CacheStats stats = m_worldCameraCache.stats();
+    stats += m_inverseViewCache.stats();
+    stats += m_frustumCache.stats();
+
+    for (const CachedValue<TransformChains, 4> &cache : m_transformChainsCache)
+        stats += cache.stats();
+
+    return stats;
+}
+
+SceneParameters SceneRenderer::parameters() const
+{
+    SceneParameters parameters;
+
+    parameters.modelScale = m_modelScale;
+    parameters.modelRotate = m_modelRotate;
+    parameters.modelTranslate = m_modelTranslate;
+
+    parameters.viewPosition = m_viewPosition;
+    parameters.viewTarget = m_viewTarget;
+    parameters.viewUpVec = m_viewUpVec;
+
+    parameters.projectionNear = m_projectionNear;
+    parameters.projectionFar = m_projectionFar;
+    parameters.projectionFov = m_projectionFov;
+
+    return parameters;
+}
+
+void SceneRenderer::setParameters(const SceneParameters &parameters)
+{
+    unsigned flags = 0;
+
+    if (parameters.modelScale != m_modelScale || parameters.modelRotate != m_modelRotate || parameters.modelTranslate != m_modelTranslate)
+        flags |= ModelDirty;
+
+    if (parameters.viewPosition != m_viewPosition || parameters.viewTarget != m_viewTarget || parameters.viewUpVec != m_viewUpVec)
+        flags |= ViewDirty;
+
+    if (parameters.projectionNear != m_projectionNear || parameters.projectionFar != m_projectionFar || parameters.projectionFov != m_projectionFov)
+        flags |= ProjectionDirty;
+
+    if (!flags)
+        return;
+
+    m_modelScale = parameters.modelScale;
+    m_modelRotate = parameters.modelRotate;
+    m_modelTranslate = parameters.modelTranslate;
+
+    m_viewPosition = parameters.viewPosition;
+    m_viewTarget = parameters.viewTarget;
+    m_viewUpVec = parameters.viewUpVec;
+
+    m_projectionNear = parameters.projectionNear;
+    m_projectionFar = parameters.projectionFar;
+    m_projectionFov = parameters.projectionFov;
+
+    markDirty(flags);
+}
+
+SceneRenderer::State SceneRenderer::state() const
+{
+    State state;
+
+    state.parameters = parameters();
+    state.currentSpace = m_currentSpace;
+    state.splitView = m_splitView;
+    state.gridMode = m_gridMode;
+    state.numOfInstances = numOfInstances();
+    state.selectedInstance = m_selectedInstance;
+    state.worldCameraPosition = m_worldCameraPosition;
+    state.worldCameraTarget = m_worldCameraTarget;
+    state.width = m_windowWidth;
+    state.height = m_windowHeight;
+    state.shaderReloads = m_appliedState.shaderReloads;
+    state.numOfChanges = m_appliedState.numOfChanges;
+
+    return state;
+}
+
+namespace
+{
+    // Sets the components of a parameter that changed, true if there were any
+    bool applyChanged(const glm::vec3 &value, const glm::vec3 &previous, glm::vec3 &field)
+    {
+        bool changed = false;
+        for (int i = 0; i < 3; ++i)
+        {
+            if (value[i] != previous[i] && value[i] != field[i])
+            {
+                field[i] = value[i];
+                changed = true;
+            }
+        }
+
+        return changed;
+    }
+
+    bool applyChanged(float value, float previous, float &field)
+    {
+        if (value == previous || value == field)
+            return false;
+
+        field = value;
+        return true;
+    }
+}
+
+void SceneRenderer::setState(const State &state)
+{
+    const State &previous = m_appliedState;
+    m_applyingState = true;
+
+    // However many there were, they are applied at once
+    m_changesThisFrame += state.numOfChanges - previous.numOfChanges;
+
+    if (state.width != previous.width || state.height != previous.height)
+        resize(state.width, state.height);
+
+    // Edits made before the selection changed belong to the instance selected then
+    const SceneParameters &parameters = state.parameters;
+    const SceneParameters &old = previous.parameters;
+    unsigned flags = 0;
+
+    if (applyChanged(parameters.modelScale, old.modelScale, m_modelScale) |
+        applyChanged(parameters.modelRotate, old.modelRotate, m_modelRotate) |
+        applyChanged(parameters.modelTranslate, old.modelTranslate, m_modelTranslate))
+        flags |= ModelDirty;
+
+    if (applyChanged(parameters.viewPosition, old.viewPosition, m_viewPosition) |
+        applyChanged(parameters.viewTarget, old.viewTarget, m_viewTarget) |
+        applyChanged(parameters.viewUpVec, old.viewUpVec, m_viewUpVec))
+        flags |= ViewDirty;
+
+    if (applyChanged(parameters.projectionNear, old.projectionNear, m_projectionNear) |
+        applyChanged(parameters.projectionFar, old.projectionFar, m_projectionFar) |
+        applyChanged(parameters.projectionFov, old.projectionFov, m_projectionFov))
+        flags |= ProjectionDirty;
+
+    if (flags)
+        markDirty(flags);
+
+    if (state.numOfInstances != previous.numOfInstances)
+        setNumOfInstances(state.numOfInstances);
+
+    if (state.selectedInstance != previous.selectedInstance)
+        selectInstance(state.selectedInstance);
+
+    setCurrentSpace(state.currentSpace);
+    setSplitView(state.splitView);
+    m_gridMode = state.gridMode;
+
+    if (state.worldCameraPosition != m_worldCameraPosition || state.worldCameraTarget != m_worldCameraTarget)
+    {
+        m_worldCameraPosition = state.worldCameraPosition;
+        m_worldCameraTarget = state.worldCameraTarget;
+        markDirty(CameraDirty);
+    }
+
+    if (state.shaderReloads != previous.shaderReloads)
+        m_shaderReloadRequested = true;
+
+    m_appliedState = state;
+    m_applyingState = false;
+}
+
+SceneRenderer::FrameInfo SceneRenderer::frameInfo() const
+{
+    FrameInfo info;
+    info.numOfVisibleInstances = m_numOfVisibleInstances;
+    info.matrixCache = matrixCacheStats();
+    return info;
+}
+
+void SceneRenderer::setCurrentSpace(Space space)
+{
+    if (space == m_currentSpace)
+        return;
+
+    m_currentSpace = space;
+    emit currentSpaceChanged(m_currentSpace);
+    markDirty(SpaceDirty);
+}
+
+void SceneRenderer::moveWorldCamera(const glm::vec3 &positionOffset, const glm::vec3 &targetOffset)
+{
+    m_worldCameraPosition += positionOffset;
+    m_worldCameraTarget += targetOffset;
+    markDirty(CameraDirty);
+}
@@ -0,0 +1,437 @@
+#ifndef SCENERENDERER_H
+#define SCENERENDERER_H
+
+#include <QImage>
+#include <QObject>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QSurfaceFormat>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "mesh.h"
+#include "transformengine.h"
+#include "clipstage.h"
+#include "frameprofiler.h"
+#include "cachedvalue.h"
+#include "geometryarena.h"
+#include "shadermanager.h"
+#include "bvh.h"
+#include "softwarerasterizer.h"
+#include "sceneparameters.h"
+
+// Draws the scene into the currently bound framebuffer of the current OpenGL context,
+// or into an image with the software backend. Used by SceneWidget on screen and by
+// OffscreenRenderer for headless rendering.
+class SceneRenderer : public QObject, protected QOpenGLFunctions_3_3_Core
+{
+    Q_OBJECT
+
+public:
+    explicit SceneRenderer(QObject *parent = 0);
+    ~SceneRenderer();
+
+    enum class Space
+    {
+        Model, World, View, NDC, RenderedImage
+    };
+
+    static constexpr int NumOfSpaces = 5;
+
+    // Lines: the fixed 20x20 grid of line segments. Infinite: drawn per pixel
+    // in a fragment shader, fading out with distance, at the same cost at any scale.
+    enum class GridMode
+    {
+        Lines, Infinite
+    };
+
+    // OpenGL: on the GPU, needs an OpenGL 3.3 core context to be current.
+    // Software: with the multithreaded rasterizer on the CPU, for machines without
+    // a usable driver. Same draws, the infinite grid is drawn as the line grid.
+    enum class Backend
+    {
+        OpenGL, Software
+    };
+
+    // Only takes effect when set before initialize()
+    Backend backend() const { return m_backend; }
+    void setBackend(Backend backend) { m_backend = backend; }
+
+    // Frame drawn by the last render() with the software backend
+    const QImage &softwareImage() const { return m_rasterizer.image(); }
+
+    // Format the OpenGL context has to be created with
+    static QSurfaceFormat surfaceFormat();
+
+    void initialize();
+    void render();
+    void resize(int w, int h);
+
+    Space currentSpace() const { return m_currentSpace; }
+    void setCurrentSpace(Space space);
+
+    // Shows all five spaces at once in a 3x2 grid of viewports, drawn in a single pass
+    bool splitView() const { return m_splitView; }
+    void setSplitView(bool split);
+
+    GridMode gridMode() const { return m_gridMode; }
+    void setGridMode(GridMode mode) { m_gridMode = mode; emit updateRequested(); }
+
+    glm::vec3 worldCameraPosition() const { return m_worldCameraPosition; }
+    glm::vec3 worldCameraTarget() const { return m_worldCameraTarget; }
+    glm::vec3 worldCameraUpVec() const { return m_worldCameraUpVec; }
+    void moveWorldCamera(const glm::vec3 &positionOffset, const glm::vec3 &targetOffset);
+
+    // Copies of the mesh drawn with a single instanced draw call. The model
+    // parameters edit the selected instance, the others are laid out on a grid.
+    unsigned numOfInstances() const { return static_cast<unsigned>(m_instances.size()); }
+    void setNumOfInstances(unsigned count);
+    unsigned selectedInstance() const { return m_selectedInstance; }
+    void selectInstance(unsigned index);
+
+    // Instances inside the frustum of the view camera, only these are drawn in the rendered image
+    unsigned numOfVisibleInstances() const { return m_numOfVisibleInstances; }
+
+    SceneParameters parameters() const;
+
+    // Sets all parameters at once, recalculating only what changed.
+    // Cheaper than the individual setters for animations.
+    void setParameters(const SceneParameters &parameters);
+
+    // Everything the user can change, as a snapshot that can be handed to another thread
+    struct State
+    {
+        SceneParameters parameters;
+        Space currentSpace;
+        bool splitView;
+        GridMode gridMode;
+        unsigned numOfInstances;
+        unsigned selectedInstance;
+        glm::vec3 worldCameraPosition;
+        glm::vec3 worldCameraTarget;
+
+        // Window size in pixels
+        int width;
+        int height;
+
+        // Shaders are reloaded every time this changes
+        unsigned shaderReloads;
+
+        // Number of changes made to the state so far, counted by whoever makes them
+        unsigned numOfChanges;
+    };
+
+    State state() const;
+
+    // Applies what changed since the previous state, like the individual setters would:
+    // a parameter that stayed the same keeps the value the renderer has, e.g. of a newly
+    // selected instance. Does not request a frame, the caller renders one anyway.
+    void setState(const State &state);
+
+    // Statistics of the last frame
+    struct FrameInfo
+    {
+        unsigned numOfVisibleInstances;
+        CacheStats matrixCache;
+    };
+
+    FrameInfo frameInfo() const;
+
+public slots:
+    void setModelScaleX(float val) { setValue(m_modelScale.x, val, ModelDirty); }
+    void setModelScaleY(float val) { setValue(m_modelScale.y, val, ModelDirty); }
+    void setModelScaleZ(float val) { setValue(m_modelScale.z, val, ModelDirty); }
+
+    void setModelRotateX(float val) { setValue(m_modelRotate.x, val, ModelDirty); }
+    void setModelRotateY(float val) { setValue(m_modelRotate.y, val, ModelDirty); }
+    void setModelRotateZ(float val) { setValue(m_modelRotate.z, val, ModelDirty); }
+
+    void setModelTranslateX(float val) { setValue(m_modelTranslate.x, val, ModelDirty); }
+    void setModelTranslateY(float val) { setValue(m_modelTranslate.y, val, ModelDirty); }
+    void setModelTranslateZ(float val) { setValue(m_modelTranslate.z, val, ModelDirty); }
+
+    void setViewPositionX(float val) { setValue(m_viewPosition.x, val, ViewDirty); }
+    void setViewPositionY(float val) { setValue(m_viewPosition.y, val, ViewDirty); }
+    void setViewPositionZ(float val) { setValue(m_viewPosition.z, val, ViewDirty); }
+
+    void setViewTargetX(float val) { setValue(m_viewTarget.x, val, ViewDirty); }
+    void setViewTargetY(float val) { setValue(m_viewTarget.y, val, ViewDirty); }
+    void setViewTargetZ(float val) { setValue(m_viewTarget.z, val, ViewDirty); }
+
+    void setViewUpVecX(float val) { setValue(m_viewUpVec.x, val, ViewDirty); }
+    void setViewUpVecY(float val) { setValue(m_viewUpVec.y, val, ViewDirty); }
+    void setViewUpVecZ(float val) { setValue(m_viewUpVec.z, val, ViewDirty); }
+
+    void setProjectionNear(float val) { setValue(m_projectionNear, val, ProjectionDirty); }
+    void setProjectionFar(float val) { setValue(m_projectionFar, val, ProjectionDirty); }
+    void setProjectionFov(float val) { setValue(m_projectionFov, val, ProjectionDirty); }
+
+signals:
+    void modelMatrixChanged(const glm::mat4 &matrix);
+    void viewMatrixChanged(const glm::mat4 &matrix);
+    void projectionMatrixChanged(const glm::mat4 &matrix);
+    void currentSpaceChanged(const Space space);
+    void splitViewChanged(bool split);
+
+    // The model parameters edit another instance now, these are its values
+    void instanceSelected(unsigned index, const SceneParameters &parameters);
+    // Changes that went into the last frame, and the recomputes they took
+    void recomputesPerFrameChanged(unsigned changes, unsigned recomputes);
+    void updateRequested();
+
+    // Compiler log of the last shader reload, empty when it succeeded
+    void shaderErrorChanged(const QString &error);
+
+public:
+    unsigned changesPerFrame() const { return m_changesLastFrame; }
+    unsigned recomputesPerFrame() const { return m_recomputesLastFrame; }
+
+    FrameProfiler &profiler() { return m_profiler; }
+    const FrameProfiler &profiler() const { return m_profiler; }
+
+    // Hits and misses of all derived matrices together
+    CacheStats matrixCacheStats() const;
+
+    // Loads a mesh and builds its simplified levels of detail
+    void loadMesh(const std::string &path);
+
+    unsigned numOfMeshLods() const { return static_cast<unsigned>(m_meshLods.size()); }
+
+    // Level of detail drawn in the last frame, 0 is the full mesh
+    unsigned currentMeshLod() const { return m_currentMeshLod; }
+
+    // Storage of the mesh positions on the GPU, snorm16 by default
+    GeometryArena::PositionFormat meshPositionFormat() const { return m_meshPositionFormat; }
+    void setMeshPositionFormat(GeometryArena::PositionFormat format);
+
+    // Positions of the full mesh, only change in loadMesh()
+    const PositionBuffer &meshPositions() const { return m_meshPositions; }
+
+    // Part of a window of the given size a space is drawn in, origin in the bottom left corner
+    static glm::ivec4 viewportOf(Space space, int windowWidth, int windowHeight, bool splitView);
+
+    // Directory the shaders are read from, the resources in the executable by
+    // default. Only takes effect when set before initialize().
+    const std::string &shaderDirectory() const { return m_shaderDirectory; }
+    void setShaderDirectory(const std::string &directory) { m_shaderDirectory = directory; }
+
+    // Files the shaders are read from
+    std::vector<std::string> shaderPaths() const { return m_shaders.sourcePaths(); }
+
+    // Rebuilds the shaders from their files during the next frames. The old
+    // programs keep drawing until the new ones linked, and stay when they do not.
+    void reloadShaders() { m_shaderReloadRequested = true; emit updateRequested(); }
+
+private:
+    // Parts of the scene state that need to be recalculated before the next frame
+    enum DirtyFlag
+    {
+        ModelDirty = 1 << 0,
+        ViewDirty = 1 << 1,
+        ProjectionDirty = 1 << 2,
+        CameraDirty = 1 << 3,
+        MeshDirty = 1 << 4,
+        InstancesDirty = 1 << 5,
+        SpaceDirty = 1 << 6,
+        AllDirty = ModelDirty | ViewDirty | ProjectionDirty | CameraDirty | MeshDirty | InstancesDirty | SpaceDirty
+    };
+
+    // Matrix that takes the vertices of a draw call to clip space, selected per draw
+    enum TransformChain
+    {
+        MeshChain, GridChain, FrustumChain, InstancesChain, NumOfChains
+    };
+
+    // Per-frame camera data, matches the std140 Camera block in the shaders
+    struct CameraBlock
+    {
+        glm::mat4 transformChains[NumOfChains];
+        GLint selectedInstance;
+        GLint numOfVisibleInstances;
+        GLint padding[2];
+    };
+
+    static constexpr GLuint cameraBlockBinding = 0;
+
+    struct TransformChains
+    {
+        glm::mat4 matrices[NumOfChains];
+    };
+
+    typedef std::vector<GeometryArena::Vertex> FrustumVertices;
+
+    struct InstanceTransform
+    {
+        glm::vec3 scale;
+        glm::vec3 rotate;
+        glm::vec3 translate;
+    };
+
+    // A change through a setter, setState() counts the changes of its snapshot instead
+    void markDirty(unsigned flags) { m_dirtyFlags |= flags; if (!m_applyingState) { ++m_changesThisFrame; emit updateRequested(); } }
+
+    // A value that stays the same needs no frame
+    void setValue(float &field, float val, unsigned flags) { if (field != val) { field = val; markDirty(flags); } }
+    bool isOnScreen(Space space) const { return m_splitView || space == m_currentSpace; }
+    void applyPendingChanges();
+
+    void renderOpenGL();
+    void renderSoftware();
+    void drawSpaceSoftware(Space space);
+
+    void initProgram();
+    void useBuiltPrograms();
+    void updateShaderReload();
+    void bindCameraBlock(GLuint program);
+    void initData();
+    void initCameraData();
+    void updateCameraData();
+    void initMeshData();
+    void updateMeshData();
+    void initGridData();
+    void initFrustumData();
+    void updateFrustumData();
+    FrustumVertices calcFrustumVertices() const;
+    void updateClippedMesh(unsigned lod);
+    void updateInstanceData();
+    void updateSelectedInstanceData();
+
+    // Writes the model parameters into the selected instance, false when it had them already
+    bool storeSelectedInstance();
+    bool cullInstances();
+    unsigned selectMeshLod(Space space) const;
+    unsigned meshLodOf(const glm::mat4 &transform) const;
+    void drawSpace(Space space);
+    void updateViewportSize();
+    glm::ivec4 viewportOf(Space space) const { return viewportOf(space, m_windowWidth, m_windowHeight, m_splitView); }
+
+    static glm::mat4 composeModelMatrix(const InstanceTransform &transform);
+    void recalcModelMatrix();
+    void recalcViewMatrix();
+    void recalcProjectionMatrix();
+    void updateMvpMatrix();
+    CachedValue<TransformChains, 4>::Versions chainVersions(Space space) const;
+    TransformChains calcTransformChains(Space space) const;
+
+    Backend m_backend;
+    SoftwareRasterizer m_rasterizer;
+
+    // Clip space vertices of the current software draw call
+    std::vector<SoftwareRasterizer::Vertex> m_clipVertices;
+
+    // The software backend draws the helper geometry from these
+    std::vector<GeometryArena::Vertex> m_gridVertices;
+    std::vector<std::uint32_t> m_gridIndices;
+
+    ShaderManager m_shaders;
+    std::string m_shaderDirectory;
+    ShaderManager::ProgramId m_programId;
+    ShaderManager::ProgramId m_instancedProgramId;
+    ShaderManager::ProgramId m_gridProgramId;
+    bool m_shaderReloadRequested;
+    GLuint m_program;
+    GLuint m_instancedProgram;
+    GLuint m_gridProgram;
+    GeometryArena m_helperArena;
+    GeometryArena m_meshArena;
+    GeometryArena::PositionFormat m_meshPositionFormat;
+    std::vector<GeometryArena::Range> m_meshGeometry;
+    GeometryArena::Range m_gridGeometry;
+    GeometryArena::Range m_yAxisGeometry;
+    GeometryArena::Range m_frustumGeometry;
+
+    // Mesh clipped against the view volume, drawn in NDC space from the part
+    // of a range at the end of the helper arena it takes up
+    ClipStage m_clipStage;
+    GeometryArena::Range m_clippedSpace;
+    GeometryArena::Range m_clippedGeometry;
+    GLuint m_instanceVbo;
+    GLuint m_cameraUbo;
+    GLuint m_transformChainUnif;
+    GLuint m_culledUnif;
+    GLuint m_gridTransformChainUnif;
+
+    glm::mat4 m_modelMatrix;
+    glm::mat4 m_viewMatrix;
+    glm::mat4 m_projectionMatrix;
+
+    // Staging copy of the camera buffer, a CameraBlock per space
+    CameraBlock m_camera;
+    std::vector<GLubyte> m_cameraData;
+    std::size_t m_cameraBlockStride;
+
+    // Level 0 is the mesh as loaded, every next level has about a quarter of the triangles
+    std::vector<Mesh> m_meshLods;
+    unsigned m_currentMeshLod;
+    PositionBuffer m_meshPositions;
+
+    std::vector<InstanceTransform> m_instances;
+    std::vector<glm::mat4> m_instanceMatrices;
+    unsigned m_selectedInstance;
+
+    // The instance buffer holds the visible instances first, then the culled ones
+    Bvh m_instanceBvh;
+    std::vector<std::uint32_t> m_instanceOrder;
+    std::vector<std::uint32_t> m_nextInstanceOrder;
+    std::vector<std::uint32_t> m_culledInstances;
+    std::vector<std::uint32_t> m_instanceSlots;
+    std::vector<glm::mat4> m_orderedInstanceMatrices;
+    unsigned m_numOfVisibleInstances;
+
+    glm::vec3 m_modelScale;
+    glm::vec3 m_modelRotate;
+    glm::vec3 m_modelTranslate;
+
+    glm::vec3 m_viewPosition;
+    glm::vec3 m_viewTarget;
+    glm::vec3 m_viewUpVec;
+
+    glm::vec3 m_worldCameraPosition;
+    glm::vec3 m_worldCameraTarget;
+    glm::vec3 m_worldCameraUpVec;
+
+    float m_projectionNear;
+    float m_projectionFar;
+    float m_projectionFov;
+
+    Space m_currentSpace;
+    GridMode m_gridMode;
+    bool m_splitView;
+    float m_aspect;
+    int m_windowWidth;
+    int m_windowHeight;
+
+    // Size of one space on screen, a sixth of the window in split view
+    int m_viewportWidth;
+    int m_viewportHeight;
+
+    // Derived matrices, recalculated only when one of the input versions they depend on changed
+    std::uint64_t m_modelVersion;
+    std::uint64_t m_viewVersion;
+    std::uint64_t m_projectionVersion;
+    std::uint64_t m_worldCameraVersion;
+    std::uint64_t m_meshVersion;
+
+    CachedValue<glm::mat4, 1> m_worldCameraCache;
+    CachedValue<glm::mat4, 1> m_inverseViewCache;
+    CachedValue<TransformChains, 4> m_transformChainsCache[NumOfSpaces];
+    CachedValue<FrustumVertices, 1> m_frustumCache;
+
+    // State of the previous setState(), changes are relative to it
+    State m_appliedState;
+    bool m_applyingState;
+
+    unsigned m_dirtyFlags;
+    unsigned m_changesThisFrame;
+    unsigned m_changesLastFrame;
+    unsigned m_recomputesThisFrame;
+    unsigned m_recomputesLastFrame;
+
+    FrameProfiler m_profiler;
+};
+
+// Sent from the render thread in queued signals
+Q_DECLARE_METATYPE(glm::mat4)
+Q_DECLARE_METATYPE(SceneParameters)
+
+#endif // SCENERENDERER_H
@@ -1,13 +1,24 @@
 #ifndef SCENEWIDGET_H
 #define SCENEWIDGET_H
 
-#include <QOpenGLWidget>
-#include <QOpenGLFunctions_3_2_Core>
+#include <QFileSystemWatcher>
+#include <QStringList>
+#include <QTimer>
 #include <QWidget>
+#include <QWindow>
 #include <string>
 #include <glm/glm.hpp>
-
-class SceneWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_2_Core
+#include "scenerenderer.h"
+#include "animationplayer.h"
+#include "framescheduler.h"
+#include "pipelinetrace.h"
+#include "renderthread.h"
+#include "triplebuffer.h"
+
+// Shows the scene. With OpenGL a render thread draws into a child window, with
+// the software rasterizer the widget draws itself. Either way the setters only
+// change the state kept here, every frame takes the latest snapshot of it.
+class SceneWidget : public QWidget
 {
     Q_OBJECT
 
@@ -15,115 +26,142 @@ public:
     SceneWidget(QWidget *parent = 0);
     ~SceneWidget();
 
-    enum class Space
-    {
-        Model, World, View, NDC, RenderedImage
-    };
+    typedef SceneRenderer::Space Space;
+
+    // Owned by the render thread once the widget is shown, only for what does not change while drawing
+    SceneRenderer &renderer() { return m_renderer; }
+
+    // Only takes effect before the widget is shown
+    SceneRenderer::Backend backend() const { return m_renderer.backend(); }
+    void setBackend(SceneRenderer::Backend backend);
+
+    unsigned changesPerFrame() const { return m_renderer.changesPerFrame(); }
+    unsigned recomputesPerFrame() const { return m_renderer.recomputesPerFrame(); }
+
+    // Only before the widget is shown
+    void loadMesh(const std::string &path);
+
+    // Reads the shaders from a directory instead of the executable and reloads
+    // them when they change. Only takes effect before the widget is shown.
+    void setShaderDirectory(const std::string &directory) { m_renderer.setShaderDirectory(directory); }
+
+    AnimationPlayer &animationPlayer() { return m_player; }
+
+    // Every repaint of the scene goes through the scheduler
+    FrameScheduler &scheduler() { return m_scheduler; }
+
+    // Loads a keyframe file and starts playing it
+    void loadAnimation(const std::string &path);
+
+    Space currentSpace() const { return m_state.currentSpace; }
+    bool splitView() const { return m_state.splitView; }
+    unsigned numOfInstances() const { return m_state.numOfInstances; }
+
+    // Statistics of the last frame on screen
+    SceneRenderer::FrameInfo frameInfo();
+
+    // Every mesh vertex in every space, with the matrices of the last frame and the window
+    // coordinates of the rendered image. updatePipelineTrace() returns true when it recomputed them.
+    bool updatePipelineTrace();
+    const PipelineTrace &pipelineTrace() const { return m_pipelineTrace; }
 
 protected:
-    virtual void initializeGL();
-    virtual void paintGL();
-    virtual void resizeGL(int w, int h);
+    virtual void paintEvent(QPaintEvent *event);
+    virtual void resizeEvent(QResizeEvent *event);
     virtual void keyPressEvent(QKeyEvent *event);
 
 public slots:
-    void setModelScaleX(float val) { m_modelScale.x = val; recalcModelMatrix(); }
-    void setModelScaleY(float val) { m_modelScale.y = val; recalcModelMatrix(); }
-    void setModelScaleZ(float val) { m_modelScale.z = val; recalcModelMatrix(); }
+    void setModelScaleX(float val) { setValue(m_state.parameters.modelScale.x, val); }
+    void setModelScaleY(float val) { setValue(m_state.parameters.modelScale.y, val); }
+    void setModelScaleZ(float val) { setValue(m_state.parameters.modelScale.z, val); }
 
-    void setModelRotateX(float val) { m_modelRotate.x = val; recalcModelMatrix(); }
-    void setModelRotateY(float val) { m_modelRotate.y = val; recalcModelMatrix(); }
-    void setModelRotateZ(float val) { m_modelRotate.z = val; recalcModelMatrix(); }
+    void setModelRotateX(float val) { setValue(m_state.parameters.modelRotate.x, val); }
+    void setModelRotateY(float val) { setValue(m_state.parameters.modelRotate.y, val); }
+    void setModelRotateZ(float val) { setValue(m_state.parameters.modelRotate.z, val); }
 
-    void setModelTranslateX(float val) { m_modelTranslate.x = val; recalcModelMatrix(); }
-    void setModelTranslateY(float val) { m_modelTranslate.y = val; recalcModelMatrix(); }
-    void setModelTranslateZ(float val) { m_modelTranslate.z = val; recalcModelMatrix(); }
+    void setModelTranslateX(float val) { setValue(m_state.parameters.modelTranslate.x, val); }
+    void setModelTranslateY(float val) { setValue(m_state.parameters.modelTranslate.y, val); }
+    void setModelTranslateZ(float val) { setValue(m_state.parameters.modelTranslate.z, val); }
 
-    void setViewPositionX(float val) { m_viewPosition.x = val; recalcViewMatrix(); }
-    void setViewPositionY(float val) { m_viewPosition.y = val; recalcViewMatrix(); }
-    void setViewPositionZ(float val) { m_viewPosition.z = val; recalcViewMatrix(); }
+    void setViewPositionX(float val) { setValue(m_state.parameters.viewPosition.x, val); }
+    void setViewPositionY(float val) { setValue(m_state.parameters.viewPosition.y, val); }
+    void setViewPositionZ(float val) { setValue(m_state.parameters.viewPosition.z, val); }
 
-    void setViewTargetX(float val) { m_viewTarget.x = val; recalcViewMatrix(); }
-    void setViewTargetY(float val) { m_viewTarget.y = val; recalcViewMatrix(); }
-    void setViewTargetZ(float val) { m_viewTarget.z = val; recalcViewMatrix(); }
+    void setViewTargetX(float val) { setValue(m_state.parameters.viewTarget.x, val); }
+    void setViewTargetY(float val) { setValue(m_state.parameters.viewTarget.y, val); }
+    void setViewTargetZ(float val) { setValue(m_state.parameters.viewTarget.z, val); }
 
-    void setViewUpVecX(float val) { m_viewUpVec.x = val; recalcViewMatrix(); }
-    void setViewUpVecY(float val) { m_viewUpVec.y = val; recalcViewMatrix(); }
-    void setViewUpVecZ(float val) { m_viewUpVec.z = val; recalcViewMatrix(); }
+    void setViewUpVecX(float val) { setValue(m_state.parameters.viewUpVec.x, val); }
+    void setViewUpVecY(float val) { setValue(m_state.parameters.viewUpVec.y, val); }
+    void setViewUpVecZ(float val) { setValue(m_state.parameters.viewUpVec.z, val); }
 
-    void setProjectionNear(float val) { m_projectionNear = val; recalcProjectionMatrix(); }
-    void setProjectionFar(float val) { m_projectionFar = val; recalcProjectionMatrix(); }
-    void setProjectionFov(float val) { m_projectionFov = val; recalcProjectionMatrix(); }
+    void setProjectionNear(float val) { setValue(m_state.parameters.projectionNear, val); }
+    void setProjectionFar(float val) { setValue(m_state.parameters.projectionFar, val); }
+    void setProjectionFov(float val) { setValue(m_state.parameters.projectionFov, val); }
 
+    void setParameters(const SceneParameters &parameters);
 
 signals:
     void modelMatrixChanged(const glm::mat4 &matrix);
     void viewMatrixChanged(const glm::mat4 &matrix);
     void projectionMatrixChanged(const glm::mat4 &matrix);
     void currentSpaceChanged(const Space space);
+    void splitViewChanged(bool split);
 
-private:
-    void initProgram();
-    std::string getFileContents(const std::string &path) const;
-    GLuint compileShader(const std::string &path, GLenum type);
-    void checkShaderErrors(GLuint shader, bool isProgram, GLenum param, const std::string &errorMsg);
-    void initData();
-    void initCubeData();
-    void initGridData();
-    void initFrustumData();
-    void initNdcData();
-    void updateFrustumData();
-    void updateNdcData();
-
-    void recalcModelMatrix();
-    void recalcViewMatrix();
-    void recalcProjectionMatrix();
-    void updateMvpMatrix();
-
-    GLuint m_program;
-    GLuint m_cubeVao;
-    GLuint m_cubeVertexDataVbo;
-    GLuint m_cubeIndicesVbo;
-    GLuint m_gridVao;
-    GLuint m_gridVertexDataVbo;
-    GLuint m_gridColorDataVbo;
-    GLuint m_frustumVao;
-    GLuint m_frustumVertexDataVbo;
-    GLuint m_frustumColorDataVbo;
-    GLuint m_frustumIndicesVbo;
-    GLuint m_ndcVao;
-    GLuint m_ndcVertexDataVbo;
-    GLuint m_ndcIndicesVbo;
-    GLuint m_mvpMatrixUnif;
+    // Another instance was selected, the model parameters now hold its values
+    void selectedInstanceChanged(const SceneParameters &parameters);
+    void recomputesPerFrameChanged(unsigned changes, unsigned recomputes);
+    void shaderErrorChanged(const QString &error);
+
+    // A frame was put on screen, with either backend
+    void frameSwapped();
+
+private slots:
+    void onShaderFileChanged(const QString &path);
+    void onShaderReloadTimeout();
+    void onRenderFailed(const QString &error);
+    void updateScene();
 
+private:
+    // Every change of the state is counted, the renderer reports how many went into a frame
+    void countChange() { ++m_state.numOfChanges; m_scheduler.requestFrame(); }
+
+    // A value that stays the same needs no frame
+    void setValue(float &field, float val) { if (field != val) { field = val; countChange(); } }
+    void setCurrentSpace(Space space);
+    void moveWorldCamera(const glm::vec3 &positionOffset, const glm::vec3 &targetOffset);
+    void startRenderThread();
+    void initializeScene();
+
+    SceneRenderer m_renderer;
+
+    // State as the user set it, published to the renderer once per frame
+    SceneRenderer::State m_state;
+    TripleBuffer<SceneRenderer::State> m_states;
+    TripleBuffer<SceneRenderer::FrameInfo> m_frameInfos;
+
+    // The OpenGL backend draws into this window on the render thread, both are null with the software one
+    QWindow *m_glWindow;
+    QWidget *m_glContainer;
+    RenderThread *m_renderThread;
+    bool m_initialized;
+
+    // Inputs of the pipeline trace, as of the last frame
     glm::mat4 m_modelMatrix;
     glm::mat4 m_viewMatrix;
     glm::mat4 m_projectionMatrix;
-
-    glm::mat4 m_mvpMatrix;
-    glm::mat4 m_gridMvpMatrix;
-    glm::mat4 m_frustumMvpMatrix;
-
-    constexpr static unsigned numOfVertices = 24;
-
-    glm::vec3 m_modelScale;
-    glm::vec3 m_modelRotate;
-    glm::vec3 m_modelTranslate;
-
-    glm::vec3 m_viewPosition;
-    glm::vec3 m_viewTarget;
-    glm::vec3 m_viewUpVec;
-
-    glm::vec3 m_worldCameraPosition;
-    glm::vec3 m_worldCameraTarget;
-    glm::vec3 m_worldCameraUpVec;
-
-    float m_projectionNear;
-    float m_projectionFar;
-    float m_projectionFov;
-
-    Space m_currentSpace;
-    float m_aspect;
+    glm::ivec4 m_traceViewport;
+    PipelineTrace::Versions m_traceVersions;
+    PipelineTrace m_pipelineTrace;
+
+    AnimationPlayer m_player;
+    FrameScheduler m_scheduler;
+
+    // Shaders are reloaded shortly after their files change, editors often write them in steps
+    QFileSystemWatcher m_shaderWatcher;
+    QStringList m_shaderPaths;
+    QTimer m_shaderReloadTimer;
+    int m_shaderRetries;
 };
 
 #endif // SCENEWIDGET_H
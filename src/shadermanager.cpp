@@ -0,0 +1,419 @@
+#include "shadermanager.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QOpenGLContext>
+#include <QResource>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+ShaderManager::ShaderManager() :
+    m_gl(nullptr), m_getProgramBinary(nullptr), m_programBinary(nullptr), m_programParameteri(nullptr), m_completionStatusSupported(false),
+    m_numOfCachedPrograms(0), m_reloadStatus(ReloadStatus::Idle)
+{
+
+}
+
+void ShaderManager::initialize(QOpenGLFunctions_3_3_Core *gl, const QString &cacheDirectory)
+{
+    m_gl = gl;
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    const QSurfaceFormat format = context->format();
+
+    // Let the driver compile on as many threads as it likes
+    MaxShaderCompilerThreadsProc maxShaderCompilerThreads = nullptr;
+    if (context->hasExtension("GL_KHR_parallel_shader_compile"))
+        maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(context->getProcAddress("glMaxShaderCompilerThreadsKHR"));
+    else if (context->hasExtension("GL_ARB_parallel_shader_compile"))
+        maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsProc>(context->getProcAddress("glMaxShaderCompilerThreadsARB"));
+
+    if (maxShaderCompilerThreads)
+        maxShaderCompilerThreads(0xFFFFFFFF);
+
+    // Both extensions add the same query
+    m_completionStatusSupported = maxShaderCompilerThreads != nullptr;
+
+    // Program binaries are core since OpenGL 4.1, some drivers support no formats at all
+    const bool binariesSupported = format.majorVersion() > 4 || (format.majorVersion() == 4 && format.minorVersion() >= 1) ||
+                                   context->hasExtension("GL_ARB_get_program_binary");
+
+    GLint numOfBinaryFormats = 0;
+    if (binariesSupported)
+        m_gl->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numOfBinaryFormats);
+
+    if (numOfBinaryFormats > 0 && !cacheDirectory.isEmpty())
+    {
+        m_getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(context->getProcAddress("glGetProgramBinary"));
+        m_programBinary = reinterpret_cast<ProgramBinaryProc>(context->getProcAddress("glProgramBinary"));
+        m_programParameteri = reinterpret_cast<ProgramParameteriProc>(context->getProcAddress("glProgramParameteri"));
+
+        if (m_getProgramBinary && m_programBinary && m_programParameteri)
+            m_cacheDirectory = cacheDirectory;
+    }
+
+    // Binaries only load on the driver that wrote them
+    m_driver = QByteArray(reinterpret_cast<const char *>(m_gl->glGetString(GL_VENDOR))) + '\n' +
+               QByteArray(reinterpret_cast<const char *>(m_gl->glGetString(GL_RENDERER))) + '\n' +
+               QByteArray(reinterpret_cast<const char *>(m_gl->glGetString(GL_VERSION)));
+}
+
+ShaderManager::ProgramId ShaderManager::add(const std::string &vertexPath, const std::string &fragmentPath)
+{
+    const Program program = { vertexPath, fragmentPath, QByteArray(), 0, false };
+    m_programs.push_back(program);
+    return m_programs.size() - 1;
+}
+
+void ShaderManager::build()
+{
+    m_numOfCachedPrograms = 0;
+
+    // Cached programs first, the others are compiled
+    std::vector<Program *> toCompile;
+    for (Program &program : m_programs)
+    {
+        if (program.built)
+            continue;
+
+        program.key = cacheKey(program);
+        if (loadBinary(program))
+            ++m_numOfCachedPrograms;
+        else
+            toCompile.push_back(&program);
+    }
+
+    // Submit all work without waiting for any of it
+    for (Program *program : toCompile)
+        program->program = submitProgram(*program);
+
+    checkCompileErrors();
+
+    for (Program *program : toCompile)
+    {
+        checkShaderErrors(program->program, true, GL_LINK_STATUS, "Could not link program");
+
+#ifndef QT_NO_DEBUG
+        m_gl->glValidateProgram(program->program);
+        checkShaderErrors(program->program, true, GL_VALIDATE_STATUS, "Could not validate program");
+#endif
+
+        storeBinary(*program);
+        program->built = true;
+    }
+
+    releaseShaders();
+}
+
+std::vector<std::string> ShaderManager::sourcePaths() const
+{
+    std::vector<std::string> paths;
+    for (const Program &program : m_programs)
+    {
+        for (const std::string &path : { program.vertexPath, program.fragmentPath })
+        {
+            if (std::find(paths.begin(), paths.end(), path) == paths.end())
+                paths.push_back(path);
+        }
+    }
+
+    return paths;
+}
+
+void ShaderManager::startReload()
+{
+    cancelReload();
+
+    // Sources are read again, they may have changed since the last build
+    m_sources.clear();
+
+    try
+    {
+        for (const Program &program : m_programs)
+        {
+            Program reloaded = program;
+            reloaded.key = cacheKey(program);
+            m_reloadPrograms.push_back(std::make_pair(submitProgram(reloaded), reloaded.key));
+        }
+    }
+    catch (const std::exception &e)
+    {
+        // E.g. a file that an editor is still saving
+        cancelReload();
+        m_reloadError = e.what();
+        m_reloadStatus = ReloadStatus::Failed;
+        return;
+    }
+
+    m_reloadStatus = ReloadStatus::Pending;
+}
+
+ShaderManager::ReloadStatus ShaderManager::pollReload()
+{
+    if (m_reloadStatus != ReloadStatus::Pending)
+    {
+        const ReloadStatus status = m_reloadStatus;
+        m_reloadStatus = ReloadStatus::Idle;
+        return status;
+    }
+
+    // Without waiting for the driver, when it can tell
+    if (m_completionStatusSupported)
+    {
+        for (const auto &reloaded : m_reloadPrograms)
+        {
+            GLint completed;
+            m_gl->glGetProgramiv(reloaded.first, GL_COMPLETION_STATUS_KHR, &completed);
+            if (!completed)
+                return ReloadStatus::Pending;
+        }
+    }
+
+    try
+    {
+        checkCompileErrors();
+        for (const auto &reloaded : m_reloadPrograms)
+            checkShaderErrors(reloaded.first, true, GL_LINK_STATUS, "Could not link program");
+    }
+    catch (const std::exception &e)
+    {
+        cancelReload();
+        m_reloadError = e.what();
+        m_reloadStatus = ReloadStatus::Idle;
+        return ReloadStatus::Failed;
+    }
+
+    // All linked, swap them in at once
+    for (std::size_t i = 0; i < m_programs.size(); ++i)
+    {
+        Program &program = m_programs[i];
+        m_gl->glDeleteProgram(program.program);
+        program.program = m_reloadPrograms[i].first;
+        program.key = m_reloadPrograms[i].second;
+        storeBinary(program);
+    }
+
+    m_reloadPrograms.clear();
+    releaseShaders();
+
+    m_reloadError.clear();
+    m_reloadStatus = ReloadStatus::Idle;
+    return ReloadStatus::Succeeded;
+}
+
+GLuint ShaderManager::submitProgram(const Program &program)
+{
+    GLuint id = m_gl->glCreateProgram();
+    m_gl->glAttachShader(id, shader(program.vertexPath, GL_VERTEX_SHADER));
+    m_gl->glAttachShader(id, shader(program.fragmentPath, GL_FRAGMENT_SHADER));
+
+    if (!m_cacheDirectory.isEmpty())
+        m_programParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    m_gl->glLinkProgram(id);
+    return id;
+}
+
+void ShaderManager::checkCompileErrors()
+{
+    // Querying a status waits for that shader only
+    for (const auto &shader : m_shaders)
+    {
+        const std::string typeStr = shader.first.second == GL_VERTEX_SHADER ? "vertex" : "fragment";
+        checkShaderErrors(shader.second, false, GL_COMPILE_STATUS, "Could not compile " + typeStr + " shader " + shader.first.first);
+    }
+}
+
+void ShaderManager::releaseShaders()
+{
+    // Deleted once the programs they are attached to are
+    for (const auto &shader : m_shaders)
+        m_gl->glDeleteShader(shader.second);
+
+    m_shaders.clear();
+    m_sources.clear();
+}
+
+void ShaderManager::cancelReload()
+{
+    for (const auto &reloaded : m_reloadPrograms)
+        m_gl->glDeleteProgram(reloaded.first);
+
+    m_reloadPrograms.clear();
+    releaseShaders();
+    m_reloadStatus = ReloadStatus::Idle;
+}
+
+QString ShaderManager::defaultCacheDirectory()
+{
+    const QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    return location.isEmpty() ? QString() : location + "/shaders";
+}
+
+const QByteArray &ShaderManager::source(const std::string &path)
+{
+    auto it = m_sources.find(path);
+    if (it != m_sources.end())
+        return it->second;
+
+    // Embedded in the executable, used in place unless rcc compressed it
+    if (!path.empty() && path[0] == ':')
+    {
+        const QResource resource(QString::fromStdString(path));
+        if (!resource.isValid())
+            throw std::runtime_error("Could not open resource: " + path);
+
+        const char *data = reinterpret_cast<const char *>(resource.data());
+        const int size = static_cast<int>(resource.size());
+        return m_sources[path] = resource.isCompressed() ? qUncompress(resource.data(), size) : QByteArray::fromRawData(data, size);
+    }
+
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly))
+        throw std::runtime_error("Could not open file: " + path);
+
+    return m_sources[path] = file.readAll();
+}
+
+GLuint ShaderManager::shader(const std::string &path, GLenum type)
+{
+    const ShaderKey key(path, type);
+    auto it = m_shaders.find(key);
+    if (it != m_shaders.end())
+        return it->second;
+
+    GLuint shader = m_gl->glCreateShader(type);
+
+    const QByteArray &text = source(path);
+    const GLchar *sourceCStr = text.constData();
+    const GLint length = text.size();
+    m_gl->glShaderSource(shader, 1, &sourceCStr, &length);
+    m_gl->glCompileShader(shader);
+
+    m_shaders[key] = shader;
+    return shader;
+}
+
+QByteArray ShaderManager::cacheKey(const Program &program)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+
+    // Resource data is not zero terminated, the sizes keep the two sources apart
+    for (const std::string *path : { &program.vertexPath, &program.fragmentPath })
+    {
+        const QByteArray &text = source(*path);
+        hash.addData(QByteArray::number(text.size()) + '\n');
+        hash.addData(text);
+    }
+
+    hash.addData(m_driver);
+
+    return hash.result().toHex();
+}
+
+QString ShaderManager::cachePath(const QByteArray &key) const
+{
+    return m_cacheDirectory + '/' + QString::fromLatin1(key) + ".bin";
+}
+
+bool ShaderManager::loadBinary(Program &program)
+{
+    if (m_cacheDirectory.isEmpty())
+        return false;
+
+    QFile file(cachePath(program.key));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    // Binary format followed by the binary itself
+    const QByteArray data = file.readAll();
+    if (data.size() <= static_cast<int>(sizeof(GLenum)))
+        return false;
+
+    GLenum binaryFormat;
+    std::memcpy(&binaryFormat, data.constData(), sizeof binaryFormat);
+
+    program.program = m_gl->glCreateProgram();
+    m_programBinary(program.program, binaryFormat, data.constData() + sizeof binaryFormat, data.size() - static_cast<GLsizei>(sizeof binaryFormat));
+
+    // Rejected after a driver update, the program is compiled again
+    GLint status;
+    m_gl->glGetProgramiv(program.program, GL_LINK_STATUS, &status);
+    if (!status)
+    {
+        m_gl->glDeleteProgram(program.program);
+        program.program = 0;
+        return false;
+    }
+
+    program.built = true;
+    return true;
+}
+
+void ShaderManager::storeBinary(const Program &program)
+{
+    if (m_cacheDirectory.isEmpty() || !QDir().mkpath(m_cacheDirectory))
+        return;
+
+    GLint length = 0;
+    m_gl->glGetProgramiv(program.program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    QByteArray data(static_cast<int>(sizeof(GLenum)) + length, '\0');
+    GLenum binaryFormat;
+    m_getProgramBinary(program.program, length, nullptr, &binaryFormat, data.data() + sizeof binaryFormat);
+    std::memcpy(data.data(), &binaryFormat, sizeof binaryFormat);
+
+    // A cache that cannot be written only costs time on the next start
+    QFile file(cachePath(program.key));
+    if (file.open(QIODevice::WriteOnly))
+        file.write(data);
+}
+
+void ShaderManager::checkShaderErrors(GLuint shader, bool isProgram, GLenum param, const std::string &errorMsg)
+{
+    GLint status;
+    if (isProgram)
+        m_gl->glGetProgramiv(shader, param, &status);
+    else
+        m_gl->glGetShaderiv(shader, param, &status);
+
+    if (status)
+        return; // No errors
+
+    GLint logLength;
+    if (isProgram)
+        m_gl->glGetProgramiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+    else
+        m_gl->glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+
+    std::vector<GLchar> buffer(logLength > 0 ? logLength : 1, '\0');
+    if (isProgram)
+        m_gl->glGetProgramInfoLog(shader, static_cast<GLsizei>(buffer.size()), nullptr, buffer.data());
+    else
+        m_gl->glGetShaderInfoLog(shader, static_cast<GLsizei>(buffer.size()), nullptr, buffer.data());
+
+    std::ostringstream msgStream;
+    msgStream << errorMsg << ":\n" << buffer.data();
+    throw std::runtime_error(msgStream.str());
+}
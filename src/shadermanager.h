@@ -0,0 +1,116 @@
+#ifndef SHADERMANAGER_H
+#define SHADERMANAGER_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QByteArray>
+#include <QString>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Compiles and links the shader programs of the renderer. Every queued program
+// is submitted before any status is queried, so drivers with
+// GL_KHR_parallel_shader_compile build them all at once on their own threads.
+// Linked programs are stored with glGetProgramBinary, keyed by a hash of their
+// sources and the driver, and loaded from disk instead on the next start.
+//
+// Programs can be rebuilt from their current sources while the old ones stay in
+// use: startReload() submits the work, pollReload() once per frame swaps them in
+// when all of them linked. Without GL_KHR_parallel_shader_compile the driver
+// can not say whether it is done, so the first poll waits for it.
+class ShaderManager
+{
+public:
+    typedef std::size_t ProgramId;
+
+    enum class ReloadStatus
+    {
+        Idle, Pending, Succeeded, Failed
+    };
+
+    ShaderManager();
+
+    // Needs a current context. An empty cache directory disables the binary cache.
+    void initialize(QOpenGLFunctions_3_3_Core *gl, const QString &cacheDirectory);
+
+    // Queues a program, it is built by the next call to build(). Paths starting
+    // with ':' are read from the Qt resources compiled into the executable.
+    ProgramId add(const std::string &vertexPath, const std::string &fragmentPath);
+
+    // Builds all queued programs, throws std::runtime_error when one does not compile or link
+    void build();
+
+    GLuint program(ProgramId id) const { return m_programs[id].program; }
+
+    // Programs of the last build() that were loaded from the binary cache
+    unsigned numOfCachedPrograms() const { return m_numOfCachedPrograms; }
+
+    // Paths of all sources, every one only once
+    std::vector<std::string> sourcePaths() const;
+
+    // Compiles all built programs again, replacing a reload still in progress
+    void startReload();
+    bool isReloading() const { return m_reloadStatus != ReloadStatus::Idle; }
+
+    // Succeeded once all programs were swapped, program() then returns the new
+    // ones. Failed keeps the old programs, with the compiler log in reloadError().
+    ReloadStatus pollReload();
+    const std::string &reloadError() const { return m_reloadError; }
+
+    // Per-user cache location of the application
+    static QString defaultCacheDirectory();
+
+private:
+    typedef void (QOPENGLF_APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+    typedef void (QOPENGLF_APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (QOPENGLF_APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+    typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+
+    struct Program
+    {
+        std::string vertexPath;
+        std::string fragmentPath;
+        QByteArray key;
+        GLuint program;
+        bool built;
+    };
+
+    // Shaders are compiled once, even when several programs use them
+    typedef std::pair<std::string, GLenum> ShaderKey;
+
+    GLuint submitProgram(const Program &program);
+    void checkCompileErrors();
+    void releaseShaders();
+    void cancelReload();
+    const QByteArray &source(const std::string &path);
+    GLuint shader(const std::string &path, GLenum type);
+    QByteArray cacheKey(const Program &program);
+    QString cachePath(const QByteArray &key) const;
+    bool loadBinary(Program &program);
+    void storeBinary(const Program &program);
+    void checkShaderErrors(GLuint shader, bool isProgram, GLenum param, const std::string &errorMsg);
+
+    QOpenGLFunctions_3_3_Core *m_gl;
+    QString m_cacheDirectory;
+    QByteArray m_driver;
+
+    GetProgramBinaryProc m_getProgramBinary;
+    ProgramBinaryProc m_programBinary;
+    ProgramParameteriProc m_programParameteri;
+
+    bool m_completionStatusSupported;
+
+    std::vector<Program> m_programs;
+    // Sources embedded with the Qt resource system point into the executable
+    std::map<std::string, QByteArray> m_sources;
+    std::map<ShaderKey, GLuint> m_shaders;
+    unsigned m_numOfCachedPrograms;
+
+    // New program and cache key for every program while reloading
+    std::vector<std::pair<GLuint, QByteArray>> m_reloadPrograms;
+    ReloadStatus m_reloadStatus;
+    std::string m_reloadError;
+};
+
+#endif // SHADERMANAGER_H
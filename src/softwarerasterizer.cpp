@@ -0,0 +1,626 @@
+#include "softwarerasterizer.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTERIZER_HAS_SSE
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    typedef SoftwareRasterizer::Vertex Vertex;
+
+    const int tileSize = 64;
+    const int numOfSamples = 4;
+
+    // Pixels tested together against the edges of a triangle, within a tile
+    const int blockSize = 8;
+
+    // Standard 4x pattern, as offsets from the bottom left corner of the pixel
+    const float sampleX[] = { 0.375f, 0.875f, 0.125f, 0.625f };
+    const float sampleY[] = { 0.125f, 0.375f, 0.625f, 0.875f };
+
+    // Triangles are only clipped at the sides when they reach this far out of
+    // the viewport, in ndc units. Closer ones are left to the bounding box.
+    const float guardBand = 16.0f;
+
+    // Inside where dot(plane, position) >= 0: near, far and the four sides of the guard band
+    const glm::vec4 clipPlanes[] =
+    {
+        glm::vec4(0.0f, 0.0f, 1.0f, 1.0f),
+        glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),
+        glm::vec4(1.0f, 0.0f, 0.0f, guardBand),
+        glm::vec4(-1.0f, 0.0f, 0.0f, guardBand),
+        glm::vec4(0.0f, 1.0f, 0.0f, guardBand),
+        glm::vec4(0.0f, -1.0f, 0.0f, guardBand),
+    };
+
+    const int numOfClipPlanes = sizeof clipPlanes / sizeof clipPlanes[0];
+
+    // Every plane adds at most one vertex to a convex polygon
+    const int maxPolygonSize = 3 + numOfClipPlanes;
+
+    // Bit per plane the position is outside of
+    unsigned outcode(const glm::vec4 &position)
+    {
+        unsigned code = 0;
+        for (int plane = 0; plane < numOfClipPlanes; ++plane)
+        {
+            if (glm::dot(clipPlanes[plane], position) < 0.0f)
+                code |= 1u << plane;
+        }
+
+        return code;
+    }
+
+    Vertex lerp(const Vertex &a, const Vertex &b, float t)
+    {
+        Vertex result;
+        result.position = glm::mix(a.position, b.position, t);
+        result.colour = glm::mix(a.colour, b.colour, t);
+        return result;
+    }
+
+    // Sutherland-Hodgman against a single plane, returns the number of vertices left
+    int clipPolygon(const glm::vec4 &plane, const Vertex *in, int count, Vertex *out)
+    {
+        int numOfOut = 0;
+
+        for (int i = 0; i < count; ++i)
+        {
+            const Vertex &a = in[i];
+            const Vertex &b = in[(i + 1) % count];
+            const float distA = glm::dot(plane, a.position);
+            const float distB = glm::dot(plane, b.position);
+
+            if (distA >= 0.0f)
+                out[numOfOut++] = a;
+
+            if ((distA >= 0.0f) != (distB >= 0.0f))
+                out[numOfOut++] = lerp(a, b, distA / (distA - distB));
+        }
+
+        return numOfOut;
+    }
+
+    // Also maps NaN to 0
+    std::uint32_t toByte(float value)
+    {
+        const float clamped = value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+        return static_cast<std::uint32_t>(clamped * 255.0f + 0.5f);
+    }
+
+    std::uint32_t packColour(const glm::vec3 &colour)
+    {
+        return 0xff000000u | toByte(colour.r) << 16 | toByte(colour.g) << 8 | toByte(colour.b);
+    }
+}
+
+float SoftwareRasterizer::valueAt(const Plane &plane, float x, float y)
+{
+    return plane.a * x + plane.b * y + plane.c;
+}
+
+bool SoftwareRasterizer::overlaps(const Triangle &triangle, float minX, float minY, float maxX, float maxY, bool &inside)
+{
+    inside = true;
+
+    // The corners of the rectangle furthest into and out of every edge
+    for (const Plane &edge : triangle.edges)
+    {
+        const float furthestIn = valueAt(edge, edge.a > 0.0f ? maxX : minX, edge.b > 0.0f ? maxY : minY);
+        if (furthestIn < 0.0f)
+            return false;
+
+        const float furthestOut = valueAt(edge, edge.a > 0.0f ? minX : maxX, edge.b > 0.0f ? minY : maxY);
+        if (furthestOut < 0.0f)
+            inside = false;
+    }
+
+    return true;
+}
+
+bool SoftwareRasterizer::rowSpan(const Triangle &triangle, int y, int &minX, int &maxX)
+{
+    float from = static_cast<float>(minX);
+    float to = static_cast<float>(maxX);
+
+    for (const Plane &edge : triangle.edges)
+    {
+        // Where the edge reaches furthest in within the row
+        const float rest = edge.b * (edge.b > 0.0f ? y + 1.0f : static_cast<float>(y)) + edge.c;
+
+        if (edge.a > 0.0f)
+            from = std::max(from, std::floor(-rest / edge.a));
+        else if (edge.a < 0.0f)
+            to = std::min(to, std::floor(-rest / edge.a));
+        else if (rest < 0.0f)
+            return false;
+    }
+
+    if (!(from <= to))
+        return false;
+
+    minX = static_cast<int>(from);
+    maxX = static_cast<int>(to);
+    return true;
+}
+
+SoftwareRasterizer::SoftwareRasterizer() :
+    m_width(0), m_height(0), m_numOfTilesX(0), m_numOfTilesY(0), m_viewport(), m_clearColour(0xffffffffu)
+{
+    resize(1, 1);
+}
+
+void SoftwareRasterizer::resize(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+
+    if (width == m_width && height == m_height)
+        return;
+
+    m_width = width;
+    m_height = height;
+    m_numOfTilesX = (width + tileSize - 1) / tileSize;
+    m_numOfTilesY = (height + tileSize - 1) / tileSize;
+
+    m_bins.assign(m_numOfTilesX * m_numOfTilesY, std::vector<std::uint32_t>());
+    m_image = QImage(width, height, QImage::Format_RGB32);
+    setViewport(0, 0, width, height);
+}
+
+void SoftwareRasterizer::beginFrame(const glm::vec3 &clearColour)
+{
+    // Keep the capacity, the next frame is mostly the same
+    m_triangles.clear();
+    for (std::vector<std::uint32_t> &bin : m_bins)
+        bin.clear();
+
+    m_clearColour = packColour(clearColour);
+}
+
+void SoftwareRasterizer::setViewport(int x, int y, int width, int height)
+{
+    m_viewport[0] = x;
+    m_viewport[1] = y;
+    m_viewport[2] = width;
+    m_viewport[3] = height;
+}
+
+void SoftwareRasterizer::drawTriangles(const Vertex *vertices, const std::uint32_t *indices, std::size_t numOfIndices)
+{
+    Vertex polygons[2][maxPolygonSize];
+
+    for (std::size_t i = 0; i + 2 < numOfIndices; i += 3)
+    {
+        const Vertex &v0 = vertices[indices[i]];
+        const Vertex &v1 = vertices[indices[i + 1]];
+        const Vertex &v2 = vertices[indices[i + 2]];
+
+        const unsigned code0 = outcode(v0.position);
+        const unsigned code1 = outcode(v1.position);
+        const unsigned code2 = outcode(v2.position);
+
+        // Completely outside one of the planes
+        if (code0 & code1 & code2)
+            continue;
+
+        polygons[0][0] = v0;
+        polygons[0][1] = v1;
+        polygons[0][2] = v2;
+
+        // Most triangles are not cut by any plane
+        const unsigned cut = code0 | code1 | code2;
+        int count = 3;
+        int current = 0;
+
+        for (int plane = 0; cut && plane < numOfClipPlanes && count >= 3; ++plane)
+        {
+            if (cut & 1u << plane)
+            {
+                count = clipPolygon(clipPlanes[plane], polygons[current], count, polygons[1 - current]);
+                current = 1 - current;
+            }
+        }
+
+        if (count >= 3)
+            drawPolygon(polygons[current], count, true);
+    }
+}
+
+void SoftwareRasterizer::drawLines(const Vertex *vertices, const std::uint32_t *indices, std::size_t numOfIndices)
+{
+    for (std::size_t i = 0; i + 1 < numOfIndices; i += 2)
+    {
+        const Vertex &a = vertices[indices[i]];
+        const Vertex &b = vertices[indices[i + 1]];
+
+        // Part of the line inside all planes
+        float begin = 0.0f;
+        float end = 1.0f;
+
+        for (int plane = 0; plane < numOfClipPlanes && begin < end; ++plane)
+        {
+            const float distA = glm::dot(clipPlanes[plane], a.position);
+            const float distB = glm::dot(clipPlanes[plane], b.position);
+
+            if (distA < 0.0f && distB < 0.0f)
+                end = begin;
+            else if (distA < 0.0f)
+                begin = std::max(begin, distA / (distA - distB));
+            else if (distB < 0.0f)
+                end = std::min(end, distA / (distA - distB));
+        }
+
+        if (begin >= end)
+            continue;
+
+        const WindowVertex start = toWindow(lerp(a, b, begin));
+        const WindowVertex stop = toWindow(lerp(a, b, end));
+
+        // Drawn as a rectangle one pixel wide, like OpenGL does with multisampling
+        const glm::vec2 direction(stop.x - start.x, stop.y - start.y);
+        const float length = glm::length(direction);
+        if (!(length > 0.0f))
+            continue;
+
+        const glm::vec2 offset = glm::vec2(-direction.y, direction.x) * (0.5f / length);
+
+        WindowVertex corners[4] = { start, start, stop, stop };
+        corners[0].x -= offset.x; corners[0].y -= offset.y;
+        corners[1].x += offset.x; corners[1].y += offset.y;
+        corners[2].x += offset.x; corners[2].y += offset.y;
+        corners[3].x -= offset.x; corners[3].y -= offset.y;
+
+        // Lines have no back side
+        setupTriangle(corners[0], corners[1], corners[2], false);
+        setupTriangle(corners[0], corners[2], corners[3], false);
+    }
+}
+
+void SoftwareRasterizer::drawPolygon(const Vertex *polygon, std::size_t count, bool cull)
+{
+    WindowVertex window[maxPolygonSize];
+    for (std::size_t i = 0; i < count; ++i)
+        window[i] = toWindow(polygon[i]);
+
+    // Clipping keeps the polygon convex and its winding, a fan covers it
+    for (std::size_t i = 1; i + 1 < count; ++i)
+        setupTriangle(window[0], window[i], window[i + 1], cull);
+}
+
+SoftwareRasterizer::WindowVertex SoftwareRasterizer::toWindow(const Vertex &vertex) const
+{
+    const float invW = 1.0f / vertex.position.w;
+
+    WindowVertex window;
+    window.x = m_viewport[0] + (vertex.position.x * invW + 1.0f) * 0.5f * m_viewport[2];
+    window.y = m_viewport[1] + (vertex.position.y * invW + 1.0f) * 0.5f * m_viewport[3];
+    window.z = vertex.position.z * invW * 0.5f + 0.5f;
+    window.invW = invW;
+    window.colourOverW = vertex.colour * invW;
+    return window;
+}
+
+void SoftwareRasterizer::setupTriangle(const WindowVertex &v0, const WindowVertex &v1, const WindowVertex &v2, bool cull)
+{
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+
+    // Counter-clockwise in window coordinates is the back with glFrontFace(GL_CW)
+    if (cull && area > 0.0f)
+        return;
+
+    // Also rejects what is left of vertices at w = 0
+    if (!(std::abs(area) > 0.0f) || !std::isfinite(area))
+        return;
+
+    // Counter-clockwise from here on, so the edge functions are positive inside
+    const WindowVertex *v[3] = { &v0, &v1, &v2 };
+    if (area < 0.0f)
+    {
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+
+    Triangle triangle;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const WindowVertex &from = *v[i];
+        const WindowVertex &to = *v[(i + 1) % 3];
+
+        Plane &edge = triangle.edges[i];
+        edge.a = from.y - to.y;
+        edge.b = to.x - from.x;
+        edge.c = -(edge.a * from.x + edge.b * from.y);
+    }
+
+    // Plane through the values at the three vertices
+    const float dx1 = v[1]->x - v[0]->x;
+    const float dy1 = v[1]->y - v[0]->y;
+    const float dx2 = v[2]->x - v[0]->x;
+    const float dy2 = v[2]->y - v[0]->y;
+
+    auto plane = [&](float value0, float value1, float value2) -> Plane {
+        Plane p;
+        p.a = ((value1 - value0) * dy2 - (value2 - value0) * dy1) / area;
+        p.b = ((value2 - value0) * dx1 - (value1 - value0) * dx2) / area;
+        p.c = value0 - p.a * v[0]->x - p.b * v[0]->y;
+        return p;
+    };
+
+    triangle.depth = plane(v[0]->z, v[1]->z, v[2]->z);
+    triangle.invW = plane(v[0]->invW, v[1]->invW, v[2]->invW);
+    for (int channel = 0; channel < 3; ++channel)
+        triangle.colour[channel] = plane(v[0]->colourOverW[channel], v[1]->colourOverW[channel], v[2]->colourOverW[channel]);
+
+    // Pixels with samples that can be covered, within the viewport
+    const float minX = std::min({v0.x, v1.x, v2.x});
+    const float maxX = std::max({v0.x, v1.x, v2.x});
+    const float minY = std::min({v0.y, v1.y, v2.y});
+    const float maxY = std::max({v0.y, v1.y, v2.y});
+
+    triangle.minX = std::max(static_cast<int>(std::floor(minX)), std::max(m_viewport[0], 0));
+    triangle.maxX = std::min(static_cast<int>(std::ceil(maxX)), std::min(m_viewport[0] + m_viewport[2], m_width)) - 1;
+    triangle.minY = std::max(static_cast<int>(std::floor(minY)), std::max(m_viewport[1], 0));
+    triangle.maxY = std::min(static_cast<int>(std::ceil(maxY)), std::min(m_viewport[1] + m_viewport[3], m_height)) - 1;
+
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    const std::uint32_t index = static_cast<std::uint32_t>(m_triangles.size());
+
+    // Only the tiles the triangle reaches into, not all of its bounding box
+    bool inside;
+    for (int tileY = triangle.minY / tileSize; tileY <= triangle.maxY / tileSize; ++tileY)
+    {
+        for (int tileX = triangle.minX / tileSize; tileX <= triangle.maxX / tileSize; ++tileX)
+        {
+            if (overlaps(triangle, tileX * tileSize, tileY * tileSize, (tileX + 1) * tileSize, (tileY + 1) * tileSize, inside))
+                m_bins[tileY * m_numOfTilesX + tileX].push_back(index);
+        }
+    }
+
+    m_triangles.push_back(triangle);
+}
+
+const QImage &SoftwareRasterizer::endFrame()
+{
+    // Detach before the threads write into it
+    m_image.bits();
+
+    const int numOfTiles = m_numOfTilesX * m_numOfTilesY;
+    std::atomic<int> nextTile(0);
+
+    // One task per thread taking tiles until none are left, tiles differ a lot in cost
+    ThreadPool &pool = ThreadPool::instance();
+    pool.parallelFor(pool.numOfThreads(), 1, [&](std::size_t, std::size_t)
+    {
+        std::vector<std::uint32_t> colours(tileSize * tileSize * numOfSamples);
+        std::vector<float> depths(tileSize * tileSize * numOfSamples);
+
+        for (int tile = nextTile++; tile < numOfTiles; tile = nextTile++)
+            rasterizeTile(tile, colours.data(), depths.data());
+    });
+
+    return m_image;
+}
+
+void SoftwareRasterizer::rasterizeTile(int tile, std::uint32_t *colours, float *depths)
+{
+    const int tileX = tile % m_numOfTilesX * tileSize;
+    const int tileY = tile / m_numOfTilesX * tileSize;
+    const int width = std::min(tileSize, m_width - tileX);
+    const int height = std::min(tileSize, m_height - tileY);
+
+    uchar *bits = m_image.bits();
+    const int bytesPerLine = m_image.bytesPerLine();
+
+    // Most tiles of the scene are empty
+    if (m_bins[tile].empty())
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            std::uint32_t *line = reinterpret_cast<std::uint32_t *>(bits + (m_height - 1 - tileY - y) * bytesPerLine) + tileX;
+            std::fill(line, line + width, m_clearColour);
+        }
+
+        return;
+    }
+
+    std::fill(colours, colours + tileSize * tileSize * numOfSamples, m_clearColour);
+    std::fill(depths, depths + tileSize * tileSize * numOfSamples, 1.0f);
+
+#ifdef RASTERIZER_HAS_SSE
+    const __m128 offsetX = _mm_loadu_ps(sampleX);
+    const __m128 offsetY = _mm_loadu_ps(sampleY);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 byteScale = _mm_set1_ps(255.0f);
+    const __m128 minInvW = _mm_set1_ps(1e-20f);
+    const __m128 allSamples = _mm_castsi128_ps(_mm_set1_epi32(-1));
+#endif
+
+    for (const std::uint32_t index : m_bins[tile])
+    {
+        const Triangle &triangle = m_triangles[index];
+        const int minX = std::max(triangle.minX, tileX);
+        const int maxX = std::min(triangle.maxX, tileX + width - 1);
+        const int minY = std::max(triangle.minY, tileY);
+        const int maxY = std::min(triangle.maxY, tileY + height - 1);
+
+#ifdef RASTERIZER_HAS_SSE
+        __m128 edgeA[3];
+        __m128 edgeB[3];
+        __m128 edgeC[3];
+        for (int i = 0; i < 3; ++i)
+        {
+            edgeA[i] = _mm_set1_ps(triangle.edges[i].a);
+            edgeB[i] = _mm_set1_ps(triangle.edges[i].b);
+            edgeC[i] = _mm_set1_ps(triangle.edges[i].c);
+        }
+
+        const __m128 depthA = _mm_set1_ps(triangle.depth.a);
+        const __m128 depthB = _mm_set1_ps(triangle.depth.b);
+        const __m128 depthC = _mm_set1_ps(triangle.depth.c);
+
+        // Blue, green, red and 1/w, in the byte order of the image
+        const __m128 shadeA = _mm_setr_ps(triangle.colour[2].a, triangle.colour[1].a, triangle.colour[0].a, triangle.invW.a);
+        const __m128 shadeB = _mm_setr_ps(triangle.colour[2].b, triangle.colour[1].b, triangle.colour[0].b, triangle.invW.b);
+        const __m128 shadeC = _mm_setr_ps(triangle.colour[2].c, triangle.colour[1].c, triangle.colour[0].c, triangle.invW.c);
+#endif
+
+        // Blocks of pixels are skipped when outside an edge, and not tested when inside all of them.
+        // Long thin triangles, like the lines, cross only a few blocks of their bounding box.
+        for (int blockY = minY; blockY <= maxY; blockY = (blockY / blockSize + 1) * blockSize)
+        {
+            const int blockMaxY = std::min((blockY / blockSize + 1) * blockSize - 1, maxY);
+
+            for (int blockX = minX; blockX <= maxX; blockX = (blockX / blockSize + 1) * blockSize)
+            {
+                const int blockMaxX = std::min((blockX / blockSize + 1) * blockSize - 1, maxX);
+
+                bool inside;
+                if (!overlaps(triangle, blockX, blockY, blockMaxX + 1, blockMaxY + 1, inside))
+                    continue;
+
+                for (int y = blockY; y <= blockMaxY; ++y)
+                {
+                    int rowMinX = blockX;
+                    int rowMaxX = blockMaxX;
+                    if (!inside && !rowSpan(triangle, y, rowMinX, rowMaxX))
+                        continue;
+
+                    float *depthRow = depths + (y - tileY) * tileSize * numOfSamples;
+                    std::uint32_t *colourRow = colours + (y - tileY) * tileSize * numOfSamples;
+
+#ifdef RASTERIZER_HAS_SSE
+                    // The part of the edge functions that stays the same along the row
+                    const __m128 sy = _mm_add_ps(_mm_set1_ps(static_cast<float>(y)), offsetY);
+                    const __m128 row0 = _mm_add_ps(_mm_mul_ps(edgeB[0], sy), edgeC[0]);
+                    const __m128 row1 = _mm_add_ps(_mm_mul_ps(edgeB[1], sy), edgeC[1]);
+                    const __m128 row2 = _mm_add_ps(_mm_mul_ps(edgeB[2], sy), edgeC[2]);
+                    const __m128 rowDepth = _mm_add_ps(_mm_mul_ps(depthB, sy), depthC);
+                    const __m128 rowShade = _mm_add_ps(_mm_mul_ps(shadeB, _mm_set1_ps(y + 0.5f)), shadeC);
+
+                    for (int x = rowMinX; x <= rowMaxX; ++x)
+                    {
+                        // All 4 samples of the pixel at once
+                        const __m128 sx = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsetX);
+                        __m128 covered = allSamples;
+
+                        if (!inside)
+                        {
+                            const __m128 inside0 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[0], sx), row0), zero);
+                            const __m128 inside1 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[1], sx), row1), zero);
+                            const __m128 inside2 = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(edgeA[2], sx), row2), zero);
+                            covered = _mm_and_ps(_mm_and_ps(inside0, inside1), inside2);
+
+                            if (!_mm_movemask_ps(covered))
+                                continue;
+                        }
+
+                        float *pixelDepths = depthRow + (x - tileX) * numOfSamples;
+                        const __m128 depth = _mm_add_ps(_mm_mul_ps(depthA, sx), rowDepth);
+                        const __m128 oldDepth = _mm_loadu_ps(pixelDepths);
+                        const __m128 passed = _mm_and_ps(covered, _mm_cmple_ps(depth, oldDepth));
+
+                        if (!_mm_movemask_ps(passed))
+                            continue;
+
+                        _mm_storeu_ps(pixelDepths, _mm_or_ps(_mm_and_ps(passed, depth), _mm_andnot_ps(passed, oldDepth)));
+
+                        // Shaded once per pixel at its centre, the colour divided by 1/w gives 1 for the alpha
+                        const __m128 shaded = _mm_add_ps(_mm_mul_ps(shadeA, _mm_set1_ps(x + 0.5f)), rowShade);
+                        const __m128 invW = _mm_max_ps(_mm_shuffle_ps(shaded, shaded, _MM_SHUFFLE(3, 3, 3, 3)), minInvW);
+                        const __m128 colour = _mm_min_ps(_mm_max_ps(_mm_div_ps(shaded, invW), zero), one);
+                        const __m128i bytes = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(colour, byteScale), half));
+                        const __m128i pixel = _mm_packus_epi16(_mm_packs_epi32(bytes, bytes), bytes);
+
+                        __m128i *pixelColours = reinterpret_cast<__m128i *>(colourRow + (x - tileX) * numOfSamples);
+                        const __m128i mask = _mm_castps_si128(passed);
+                        const __m128i packed = _mm_shuffle_epi32(pixel, 0);
+                        const __m128i oldColours = _mm_loadu_si128(pixelColours);
+                        _mm_storeu_si128(pixelColours, _mm_or_si128(_mm_and_si128(mask, packed), _mm_andnot_si128(mask, oldColours)));
+                    }
+#else
+                    for (int x = rowMinX; x <= rowMaxX; ++x)
+                    {
+                        float *pixelDepths = depthRow + (x - tileX) * numOfSamples;
+                        std::uint32_t *pixelColours = colourRow + (x - tileX) * numOfSamples;
+                        bool shaded = false;
+                        std::uint32_t packed = 0;
+
+                        for (int sample = 0; sample < numOfSamples; ++sample)
+                        {
+                            const float sx = x + sampleX[sample];
+                            const float sy = y + sampleY[sample];
+
+                            if (!inside && (valueAt(triangle.edges[0], sx, sy) < 0.0f ||
+                                            valueAt(triangle.edges[1], sx, sy) < 0.0f ||
+                                            valueAt(triangle.edges[2], sx, sy) < 0.0f))
+                                continue;
+
+                            const float depth = valueAt(triangle.depth, sx, sy);
+                            if (depth > pixelDepths[sample])
+                                continue;
+
+                            // Shaded once per pixel, at its centre
+                            if (!shaded)
+                            {
+                                const float cx = x + 0.5f;
+                                const float cy = y + 0.5f;
+                                const float w = 1.0f / std::max(valueAt(triangle.invW, cx, cy), 1e-20f);
+                                packed = packColour(glm::vec3(valueAt(triangle.colour[0], cx, cy) * w,
+                                                              valueAt(triangle.colour[1], cx, cy) * w,
+                                                              valueAt(triangle.colour[2], cx, cy) * w));
+                                shaded = true;
+                            }
+
+                            pixelDepths[sample] = depth;
+                            pixelColours[sample] = packed;
+                        }
+                    }
+#endif
+                }
+            }
+        }
+    }
+
+    // Resolve: average the samples, the image has its origin at the top
+    for (int y = 0; y < height; ++y)
+    {
+        std::uint32_t *line = reinterpret_cast<std::uint32_t *>(bits + (m_height - 1 - tileY - y) * bytesPerLine) + tileX;
+        const std::uint32_t *samples = colours + y * tileSize * numOfSamples;
+
+        for (int x = 0; x < width; ++x, samples += numOfSamples)
+        {
+#ifdef RASTERIZER_HAS_SSE
+            // Widen the bytes of the 4 samples to 16 bits and add them up per channel
+            const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples));
+            const __m128i zeroes = _mm_setzero_si128();
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi8(packed, zeroes), _mm_unpackhi_epi8(packed, zeroes));
+            sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+            sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+            line[x] = static_cast<std::uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(sum, zeroes)));
+#else
+            std::uint32_t pixel = 0;
+            for (int shift = 0; shift < 32; shift += 8)
+            {
+                std::uint32_t sum = 2;
+                for (int sample = 0; sample < numOfSamples; ++sample)
+                    sum += samples[sample] >> shift & 0xffu;
+
+                pixel |= (sum / numOfSamples) << shift;
+            }
+
+            line[x] = pixel;
+#endif
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef SOFTWARERASTERIZER_H
+#define SOFTWARERASTERIZER_H
+
+#include <QImage>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Draws triangles and lines on the CPU, for machines without a usable OpenGL driver.
+// Follows the state the OpenGL renderer sets: a GL_LEQUAL depth test, culling of
+// the back faces with clockwise front faces, and 4 samples per pixel.
+//
+// Draw calls only clip, set up and bin the primitives into tiles of 64x64 pixels.
+// endFrame() then rasterizes the tiles on the thread pool, every tile with its own
+// samples that stay in the cache, and resolves them into the image. The 4 samples
+// of a pixel are tested at once with SSE.
+class SoftwareRasterizer
+{
+public:
+    // Vertex after the vertex stage
+    struct Vertex
+    {
+        glm::vec4 position;  // Clip space
+        glm::vec3 colour;
+    };
+
+    SoftwareRasterizer();
+
+    void resize(int width, int height);
+
+    // Drops the primitives of the previous frame, the whole image is cleared to the colour
+    void beginFrame(const glm::vec3 &clearColour);
+
+    // Origin in the bottom left corner, like glViewport()
+    void setViewport(int x, int y, int width, int height);
+
+    // Indices are relative to the vertices, three per triangle or two per line
+    void drawTriangles(const Vertex *vertices, const std::uint32_t *indices, std::size_t numOfIndices);
+    void drawLines(const Vertex *vertices, const std::uint32_t *indices, std::size_t numOfIndices);
+
+    // Rasterizes everything drawn since beginFrame()
+    const QImage &endFrame();
+
+    const QImage &image() const { return m_image; }
+
+private:
+    // Value interpolated linearly in window space, a * x + b * y + c
+    struct Plane
+    {
+        float a, b, c;
+    };
+
+    // Triangle in window coordinates, ready to be rasterized
+    struct Triangle
+    {
+        // Edge functions, positive inside
+        Plane edges[3];
+
+        // Window depth, 1/w and the colour divided by w for perspective correction
+        Plane depth;
+        Plane invW;
+        Plane colour[3];
+
+        // Pixels covered, inclusive and within the viewport
+        int minX, minY, maxX, maxY;
+    };
+
+    // Vertex in window coordinates
+    struct WindowVertex
+    {
+        float x, y, z, invW;
+        glm::vec3 colourOverW;
+    };
+
+    static float valueAt(const Plane &plane, float x, float y);
+
+    // Whether the rectangle can hold covered samples, inside when all of them are
+    static bool overlaps(const Triangle &triangle, float minX, float minY, float maxX, float maxY, bool &inside);
+
+    // Narrows the pixels of a row down to the ones that can be covered, false when there are none
+    static bool rowSpan(const Triangle &triangle, int y, int &minX, int &maxX);
+
+    void drawPolygon(const Vertex *polygon, std::size_t count, bool cull);
+    void setupTriangle(const WindowVertex &v0, const WindowVertex &v1, const WindowVertex &v2, bool cull);
+    WindowVertex toWindow(const Vertex &vertex) const;
+    void rasterizeTile(int tile, std::uint32_t *colours, float *depths);
+
+    int m_width;
+    int m_height;
+    int m_numOfTilesX;
+    int m_numOfTilesY;
+    int m_viewport[4];
+    std::uint32_t m_clearColour;
+
+    std::vector<Triangle> m_triangles;
+
+    // Triangles overlapping every tile, in draw order
+    std::vector<std::vector<std::uint32_t>> m_bins;
+
+    QImage m_image;
+};
+
+#endif // SOFTWARERASTERIZER_H
@@ -24,12 +24,63 @@ INCLUDEPATH += ../glm
 SOURCES += main.cpp\
         mainwindow.cpp \
     scenewidget.cpp \
+    scenerenderer.cpp \
+    offscreenrenderer.cpp \
+    sceneoptions.cpp \
     floatslider.cpp \
-    matrixwidget.cpp
+    matrixwidget.cpp \
+    mesh.cpp \
+    meshloader.cpp \
+    processinfo.cpp \
+    threadpool.cpp \
+    transformengine.cpp \
+    pipelinetrace.cpp \
+    pipelinetracemodel.cpp \
+    clipstage.cpp \
+    frameprofiler.cpp \
+    animation.cpp \
+    animationplayer.cpp \
+    geometryarena.cpp \
+    meshsimplifier.cpp \
+    bvh.cpp \
+    shadermanager.cpp \
+    framescheduler.cpp \
+    renderthread.cpp \
+    softwarerasterizer.cpp
 
 HEADERS  += mainwindow.h \
     scenewidget.h \
+    scenerenderer.h \
+    offscreenrenderer.h \
+    sceneoptions.h \
     floatslider.h \
-    matrixwidget.h
+    matrixwidget.h \
+    mesh.h \
+    meshloader.h \
+    processinfo.h \
+    threadpool.h \
+    transformengine.h \
+    pipelinetrace.h \
+    pipelinetracemodel.h \
+    clipstage.h \
+    frameprofiler.h \
+    cachedvalue.h \
+    sceneparameters.h \
+    animation.h \
+    animationplayer.h \
+    geometryarena.h \
+    meshsimplifier.h \
+    bvh.h \
+    shadermanager.h \
+    framescheduler.h \
+    renderthread.h \
+    triplebuffer.h \
+    softwarerasterizer.h
 
 FORMS    += mainwindow.ui
+
+# Shaders are compiled into the executable, uncompressed so they can be used in place
+RESOURCES += ../res/res.qrc
+QMAKE_RESOURCE_FLAGS += -no-compress
+
+win32: LIBS += -lpsapi
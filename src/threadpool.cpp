@@ -0,0 +1,96 @@
+#include "threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned numOfThreads) :
+    m_stopping(false)
+{
+    // The thread calling parallelFor() does a share of the work too
+    for (unsigned i = 1; i < std::max(numOfThreads, 1u); ++i)
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+
+    m_taskAvailable.notify_all();
+
+    for (std::thread &worker : m_workers)
+        worker.join();
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t minChunkSize, const std::function<void(std::size_t, std::size_t)> &func)
+{
+    const std::size_t maxChunks = count / std::max<std::size_t>(minChunkSize, 1);
+    const std::size_t numOfChunks = std::min<std::size_t>(std::max<std::size_t>(maxChunks, 1), numOfThreads());
+
+    if (numOfChunks <= 1)
+    {
+        func(0, count);
+        return;
+    }
+
+    const std::size_t chunkSize = (count + numOfChunks - 1) / numOfChunks;
+
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+    std::size_t numOfPending = numOfChunks - 1;
+
+    // Hand out all chunks but the first to the workers
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (std::size_t chunk = 1; chunk < numOfChunks; ++chunk)
+        {
+            const std::size_t begin = chunk * chunkSize;
+            const std::size_t end = std::min(begin + chunkSize, count);
+
+            m_tasks.push([&, begin, end]()
+            {
+                if (begin < end)
+                    func(begin, end);
+
+                std::lock_guard<std::mutex> doneLock(doneMutex);
+                if (--numOfPending == 0)
+                    doneCondition.notify_one();
+            });
+        }
+    }
+
+    m_taskAvailable.notify_all();
+
+    // Do the first chunk on this thread
+    func(0, std::min(chunkSize, count));
+
+    std::unique_lock<std::mutex> doneLock(doneMutex);
+    doneCondition.wait(doneLock, [&]() { return numOfPending == 0; });
+}
+
+ThreadPool &ThreadPool::instance()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+            if (m_stopping && m_tasks.empty())
+                return;
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+
+        task();
+    }
+}
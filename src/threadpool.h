@@ -0,0 +1,42 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for splitting large loops into chunks
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned numOfThreads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Number of threads working on a parallelFor(), including the calling thread
+    unsigned numOfThreads() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+    // Calls func(begin, end) for disjoint ranges covering [0, count) and blocks until all are done.
+    // Ranges are at least minChunkSize long, so small loops stay on the calling thread.
+    void parallelFor(std::size_t count, std::size_t minChunkSize, const std::function<void(std::size_t, std::size_t)> &func);
+
+    // Pool shared by the whole application
+    static ThreadPool &instance();
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    bool m_stopping;
+};
+
+#endif // THREADPOOL_H
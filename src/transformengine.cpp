@@ -0,0 +1,245 @@
+#include "transformengine.h"
+#include "threadpool.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_HAS_SSE
+#include <emmintrin.h>
+#endif
+
+// With GCC and Clang the AVX kernel is compiled separately and chosen at runtime,
+// otherwise it is only used when the whole build targets AVX
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRANSFORM_HAS_AVX
+#define TRANSFORM_AVX_TARGET __attribute__((target("avx")))
+#include <immintrin.h>
+#elif defined(__AVX__)
+#define TRANSFORM_HAS_AVX
+#define TRANSFORM_AVX_TARGET
+#include <immintrin.h>
+#endif
+
+namespace
+{
+    // Scalar kernel, also used for the tail of the SIMD kernels.
+    // Sums are grouped like in the SIMD kernels so all kernels give the same results.
+    // Divide: stores xyz / w, otherwise xyz and w.
+    template <bool Divide>
+    void transformScalar(const glm::mat4 &m, const float *inX, const float *inY, const float *inZ,
+                         float *outX, float *outY, float *outZ, float *outW, std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const float x = inX[i];
+            const float y = inY[i];
+            const float z = inZ[i];
+
+            const float clipX = (m[0][0] * x + m[1][0] * y) + (m[2][0] * z + m[3][0]);
+            const float clipY = (m[0][1] * x + m[1][1] * y) + (m[2][1] * z + m[3][1]);
+            const float clipZ = (m[0][2] * x + m[1][2] * y) + (m[2][2] * z + m[3][2]);
+            const float clipW = (m[0][3] * x + m[1][3] * y) + (m[2][3] * z + m[3][3]);
+
+            if (Divide)
+            {
+                outX[i] = clipX / clipW;
+                outY[i] = clipY / clipW;
+                outZ[i] = clipZ / clipW;
+            }
+            else
+            {
+                outX[i] = clipX;
+                outY[i] = clipY;
+                outZ[i] = clipZ;
+                outW[i] = clipW;
+            }
+        }
+    }
+
+#ifdef TRANSFORM_HAS_SSE
+    template <bool Divide>
+    void transformSse(const glm::mat4 &m, const float *inX, const float *inY, const float *inZ,
+                      float *outX, float *outY, float *outZ, float *outW, std::size_t begin, std::size_t end)
+    {
+        __m128 c[4][4];
+        for (int col = 0; col < 4; ++col)
+            for (int row = 0; row < 4; ++row)
+                c[col][row] = _mm_set1_ps(m[col][row]);
+
+        std::size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            const __m128 x = _mm_loadu_ps(inX + i);
+            const __m128 y = _mm_loadu_ps(inY + i);
+            const __m128 z = _mm_loadu_ps(inZ + i);
+
+            __m128 clip[4];
+            for (int row = 0; row < 4; ++row)
+            {
+                clip[row] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c[0][row], x), _mm_mul_ps(c[1][row], y)),
+                                       _mm_add_ps(_mm_mul_ps(c[2][row], z), c[3][row]));
+            }
+
+            if (Divide)
+            {
+                _mm_storeu_ps(outX + i, _mm_div_ps(clip[0], clip[3]));
+                _mm_storeu_ps(outY + i, _mm_div_ps(clip[1], clip[3]));
+                _mm_storeu_ps(outZ + i, _mm_div_ps(clip[2], clip[3]));
+            }
+            else
+            {
+                _mm_storeu_ps(outX + i, clip[0]);
+                _mm_storeu_ps(outY + i, clip[1]);
+                _mm_storeu_ps(outZ + i, clip[2]);
+                _mm_storeu_ps(outW + i, clip[3]);
+            }
+        }
+
+        transformScalar<Divide>(m, inX, inY, inZ, outX, outY, outZ, outW, i, end);
+    }
+#endif
+
+#ifdef TRANSFORM_HAS_AVX
+    template <bool Divide>
+    TRANSFORM_AVX_TARGET
+    void transformAvx(const glm::mat4 &m, const float *inX, const float *inY, const float *inZ,
+                      float *outX, float *outY, float *outZ, float *outW, std::size_t begin, std::size_t end)
+    {
+        __m256 c[4][4];
+        for (int col = 0; col < 4; ++col)
+            for (int row = 0; row < 4; ++row)
+                c[col][row] = _mm256_set1_ps(m[col][row]);
+
+        std::size_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            const __m256 x = _mm256_loadu_ps(inX + i);
+            const __m256 y = _mm256_loadu_ps(inY + i);
+            const __m256 z = _mm256_loadu_ps(inZ + i);
+
+            __m256 clip[4];
+            for (int row = 0; row < 4; ++row)
+            {
+                clip[row] = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c[0][row], x), _mm256_mul_ps(c[1][row], y)),
+                                          _mm256_add_ps(_mm256_mul_ps(c[2][row], z), c[3][row]));
+            }
+
+            if (Divide)
+            {
+                _mm256_storeu_ps(outX + i, _mm256_div_ps(clip[0], clip[3]));
+                _mm256_storeu_ps(outY + i, _mm256_div_ps(clip[1], clip[3]));
+                _mm256_storeu_ps(outZ + i, _mm256_div_ps(clip[2], clip[3]));
+            }
+            else
+            {
+                _mm256_storeu_ps(outX + i, clip[0]);
+                _mm256_storeu_ps(outY + i, clip[1]);
+                _mm256_storeu_ps(outZ + i, clip[2]);
+                _mm256_storeu_ps(outW + i, clip[3]);
+            }
+        }
+
+        transformScalar<Divide>(m, inX, inY, inZ, outX, outY, outZ, outW, i, end);
+    }
+#endif
+
+    TransformEngine::Kernel detectKernel()
+    {
+#if defined(TRANSFORM_HAS_AVX) && defined(__GNUC__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx"))
+            return TransformEngine::Kernel::AVX;
+#elif defined(TRANSFORM_HAS_AVX)
+        return TransformEngine::Kernel::AVX;
+#endif
+
+#ifdef TRANSFORM_HAS_SSE
+        return TransformEngine::Kernel::SSE;
+#else
+        return TransformEngine::Kernel::Scalar;
+#endif
+    }
+
+    template <bool Divide>
+    void transformWith(TransformEngine::Kernel kernel, const glm::mat4 &m, const float *inX, const float *inY, const float *inZ,
+                       float *outX, float *outY, float *outZ, float *outW, std::size_t count)
+    {
+        switch (kernel)
+        {
+#ifdef TRANSFORM_HAS_AVX
+        case TransformEngine::Kernel::AVX:
+            transformAvx<Divide>(m, inX, inY, inZ, outX, outY, outZ, outW, 0, count);
+            break;
+#endif
+#ifdef TRANSFORM_HAS_SSE
+        case TransformEngine::Kernel::SSE:
+            transformSse<Divide>(m, inX, inY, inZ, outX, outY, outZ, outW, 0, count);
+            break;
+#endif
+        default:
+            transformScalar<Divide>(m, inX, inY, inZ, outX, outY, outZ, outW, 0, count);
+            break;
+        }
+    }
+}
+
+PositionBuffer PositionBuffer::fromPositions(const std::vector<glm::vec3> &positions)
+{
+    PositionBuffer buffer;
+    buffer.resize(positions.size());
+
+    for (std::size_t i = 0; i < positions.size(); ++i)
+    {
+        buffer.x[i] = positions[i].x;
+        buffer.y[i] = positions[i].y;
+        buffer.z[i] = positions[i].z;
+    }
+
+    return buffer;
+}
+
+TransformEngine::Kernel TransformEngine::kernel()
+{
+    static const Kernel detected = detectKernel();
+    return detected;
+}
+
+const char *TransformEngine::kernelName(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::Scalar:
+        return "scalar";
+    case Kernel::SSE:
+        return "SSE";
+    case Kernel::AVX:
+        return "AVX";
+    default:
+        return "unknown";
+    }
+}
+
+void TransformEngine::transformToNdc(const glm::mat4 &mvp, const PositionBuffer &in, PositionBuffer &out)
+{
+    const std::size_t count = in.size();
+    out.resize(count);
+
+    const Kernel selected = kernel();
+
+    ThreadPool::instance().parallelFor(count, parallelThreshold / 2, [&](std::size_t begin, std::size_t end)
+    {
+        transformToNdc(selected, mvp, in.x.data() + begin, in.y.data() + begin, in.z.data() + begin,
+                       out.x.data() + begin, out.y.data() + begin, out.z.data() + begin, end - begin);
+    });
+}
+
+void TransformEngine::transformToNdc(Kernel kernel, const glm::mat4 &mvp, const float *inX, const float *inY, const float *inZ,
+                                     float *outX, float *outY, float *outZ, std::size_t count)
+{
+    transformWith<true>(kernel, mvp, inX, inY, inZ, outX, outY, outZ, nullptr, count);
+}
+
+void TransformEngine::transform(Kernel kernel, const glm::mat4 &matrix, const float *inX, const float *inY, const float *inZ,
+                                float *outX, float *outY, float *outZ, float *outW, std::size_t count)
+{
+    transformWith<false>(kernel, matrix, inX, inY, inZ, outX, outY, outZ, outW, count);
+}
@@ -0,0 +1,53 @@
+#ifndef TRANSFORMENGINE_H
+#define TRANSFORMENGINE_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Structure-of-arrays vertex positions, so SIMD kernels can load 4 or 8 x's at once
+struct PositionBuffer
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+
+    std::size_t size() const { return x.size(); }
+    void resize(std::size_t size) { x.resize(size); y.resize(size); z.resize(size); }
+
+    static PositionBuffer fromPositions(const std::vector<glm::vec3> &positions);
+};
+
+// Transforms positions on the CPU, for when the coordinates themselves are needed
+// (tables, export, checking the GPU) rather than only the rendered image.
+//
+// The matrix is applied with SSE or AVX kernels, picked at runtime, and large
+// buffers are split across the application's thread pool.
+class TransformEngine
+{
+public:
+    enum class Kernel
+    {
+        Scalar, SSE, AVX
+    };
+
+    // Kernel used on this machine
+    static Kernel kernel();
+    static const char *kernelName(Kernel kernel);
+
+    // out = (mvp * (in, 1)).xyz / w
+    static void transformToNdc(const glm::mat4 &mvp, const PositionBuffer &in, PositionBuffer &out);
+
+    // Same, on raw arrays and with a fixed kernel and no threading
+    static void transformToNdc(Kernel kernel, const glm::mat4 &mvp, const float *inX, const float *inY, const float *inZ,
+                               float *outX, float *outY, float *outZ, std::size_t count);
+
+    // out = matrix * (in, 1), keeping w, on raw arrays with a fixed kernel and no threading
+    static void transform(Kernel kernel, const glm::mat4 &matrix, const float *inX, const float *inY, const float *inZ,
+                          float *outX, float *outY, float *outZ, float *outW, std::size_t count);
+
+    // Below this many vertices the work stays on the calling thread
+    static constexpr std::size_t parallelThreshold = 1 << 16;
+};
+
+#endif // TRANSFORMENGINE_H
@@ -0,0 +1,48 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+
+// Hands the latest value from one writer thread to one reader thread without locks.
+// The writer and the reader each own a slot and swap it with the shared middle one,
+// so neither ever waits for the other; values the reader was too slow for are skipped.
+template <typename T>
+class TripleBuffer
+{
+public:
+    explicit TripleBuffer(const T &value = T()) : m_slots{{value, value, value}}, m_back(0), m_front(1), m_middle(2) {}
+
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    // Writer: fill in the back slot, then publish it
+    T &back() { return m_slots[m_back]; }
+    void publish() { m_back = m_middle.exchange(m_back | Fresh, std::memory_order_acq_rel) & IndexMask; }
+
+    // Reader: takes the last published value, returns false when there is none since the previous call
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_acquire) & Fresh))
+            return false;
+
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & IndexMask;
+        return true;
+    }
+
+    const T &front() const { return m_slots[m_front]; }
+
+private:
+    // The middle index is marked fresh until the reader takes it
+    enum : unsigned
+    {
+        IndexMask = 3, Fresh = 4
+    };
+
+    std::array<T, 3> m_slots;
+    unsigned m_back;
+    unsigned m_front;
+    std::atomic<unsigned> m_middle;
+};
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,28 @@
+#-------------------------------------------------
+#
+# Tests of the mesh simplifier, run with make check
+#
+#-------------------------------------------------
+
+QT       += gui testlib
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_meshsimplifier
+TEMPLATE = app
+
+DESTDIR = ../../bin/tests
+MOC_DIR = ../../build/tests/meshsimplifier/moc
+OBJECTS_DIR = ../../build/tests/meshsimplifier/obj
+
+INCLUDEPATH += ../../glm ../../src
+
+SOURCES += tst_meshsimplifier.cpp \
+    ../../src/mesh.cpp \
+    ../../src/meshsimplifier.cpp \
+    ../../src/geometryarena.cpp
+
+HEADERS += ../../src/mesh.h \
+    ../../src/meshsimplifier.h \
+    ../../src/geometryarena.h
@@ -0,0 +1,128 @@
+#include "meshsimplifier.h"
+#include "geometryarena.h"
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+namespace
+{
+    // Sphere of rings x segments quads around the y-axis, with a single vertex at each pole.
+    // Bumps make it look more like a scan. Scaled to fit the [-1, 1] cube like MeshLoader does.
+    Mesh sphere(int rings, int segments, float bumpiness)
+    {
+        Mesh mesh;
+
+        for (int ring = 0; ring <= rings; ++ring)
+        {
+            // Poles only once
+            const int numOfSegments = ring == 0 || ring == rings ? 1 : segments;
+
+            for (int segment = 0; segment < numOfSegments; ++segment)
+            {
+                const float theta = glm::pi<float>() * ring / rings;
+                const float phi = glm::two_pi<float>() * segment / segments;
+                const float radius = 1.0f + bumpiness * std::sin(5.0f * phi) * std::sin(7.0f * theta);
+
+                mesh.positions.push_back(radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+                mesh.colours.push_back(glm::vec3(0.5f + 0.5f * std::cos(phi), 0.5f + 0.5f * std::cos(theta), 0.5f));
+            }
+        }
+
+        float largest = 0.0f;
+        for (const glm::vec3 &position : mesh.positions)
+            largest = std::max(largest, std::max(std::abs(position.x), std::max(std::abs(position.y), std::abs(position.z))));
+
+        for (glm::vec3 &position : mesh.positions)
+            position /= largest;
+
+        // Index of a vertex, the poles are the first and the last one
+        auto vertex = [rings, segments](int ring, int segment) -> std::uint32_t
+        {
+            if (ring == 0)
+                return 0;
+            if (ring == rings)
+                return 1 + (rings - 1) * segments;
+
+            return 1 + (ring - 1) * segments + segment % segments;
+        };
+
+        // Clockwise seen from outside
+        for (int ring = 0; ring < rings; ++ring)
+        {
+            for (int segment = 0; segment < segments; ++segment)
+            {
+                const std::uint32_t a = vertex(ring, segment);
+                const std::uint32_t b = vertex(ring, segment + 1);
+                const std::uint32_t c = vertex(ring + 1, segment + 1);
+                const std::uint32_t d = vertex(ring + 1, segment);
+
+                if (ring > 0)
+                    mesh.indices.insert(mesh.indices.end(), { a, c, b });
+                if (ring < rings - 1)
+                    mesh.indices.insert(mesh.indices.end(), { a, d, c });
+            }
+        }
+
+        return mesh;
+    }
+}
+
+class TestMeshSimplifier : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void lodsFitSnorm16_data();
+    void lodsFitSnorm16();
+};
+
+void TestMeshSimplifier::lodsFitSnorm16_data()
+{
+    QTest::addColumn<float>("bumpiness");
+
+    QTest::newRow("sphere") << 0.0f;
+    QTest::newRow("scan") << 0.05f;
+}
+
+// Every level of a mesh in the [-1, 1] cube has to go into the default mesh arena
+void TestMeshSimplifier::lodsFitSnorm16()
+{
+    QFETCH(float, bumpiness);
+
+    const std::vector<Mesh> lods = MeshSimplifier::buildLods(sphere(64, 128, bumpiness), 5, 64);
+    QVERIFY(lods.size() > 2);
+
+    for (std::size_t level = 0; level < lods.size(); ++level)
+    {
+        const Mesh &lod = lods[level];
+        std::vector<GeometryArena::Vertex> vertices(lod.numOfVertices());
+
+        for (std::size_t i = 0; i < vertices.size(); ++i)
+        {
+            const glm::vec3 &position = lod.positions[i];
+            QVERIFY2(std::abs(position.x) <= 1.0f && std::abs(position.y) <= 1.0f && std::abs(position.z) <= 1.0f,
+                     qPrintable(QString("Level %1 has a vertex outside the [-1, 1] cube").arg(level)));
+
+            vertices[i].position = position;
+            vertices[i].colour = lod.colours[i];
+        }
+
+        try
+        {
+            GeometryArena::pack(GeometryArena::PositionFormat::Snorm16, vertices);
+        }
+        catch (const std::exception &ex)
+        {
+            QFAIL(qPrintable(QString("Level %1: %2").arg(level).arg(ex.what())));
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestMeshSimplifier)
+
+#include "tst_meshsimplifier.moc"
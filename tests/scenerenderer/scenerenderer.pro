@@ -0,0 +1,53 @@
+#-------------------------------------------------
+#
+# Tests of the scene renderer, run with make check.
+# They use the software backend, so they need no OpenGL.
+#
+#-------------------------------------------------
+
+QT       += gui testlib
+
+CONFIG += c++11 console thread testcase
+CONFIG -= app_bundle
+
+TARGET = tst_scenerenderer
+TEMPLATE = app
+
+DESTDIR = ../../bin/tests
+MOC_DIR = ../../build/tests/scenerenderer/moc
+OBJECTS_DIR = ../../build/tests/scenerenderer/obj
+
+INCLUDEPATH += ../../glm ../../src
+
+SOURCES += tst_scenerenderer.cpp \
+    ../../src/scenerenderer.cpp \
+    ../../src/mesh.cpp \
+    ../../src/meshloader.cpp \
+    ../../src/meshsimplifier.cpp \
+    ../../src/processinfo.cpp \
+    ../../src/threadpool.cpp \
+    ../../src/transformengine.cpp \
+    ../../src/clipstage.cpp \
+    ../../src/frameprofiler.cpp \
+    ../../src/geometryarena.cpp \
+    ../../src/bvh.cpp \
+    ../../src/shadermanager.cpp \
+    ../../src/softwarerasterizer.cpp
+
+HEADERS += ../../src/scenerenderer.h \
+    ../../src/mesh.h \
+    ../../src/meshloader.h \
+    ../../src/meshsimplifier.h \
+    ../../src/processinfo.h \
+    ../../src/threadpool.h \
+    ../../src/transformengine.h \
+    ../../src/clipstage.h \
+    ../../src/frameprofiler.h \
+    ../../src/cachedvalue.h \
+    ../../src/sceneparameters.h \
+    ../../src/geometryarena.h \
+    ../../src/bvh.h \
+    ../../src/shadermanager.h \
+    ../../src/softwarerasterizer.h
+
+win32: LIBS += -lpsapi
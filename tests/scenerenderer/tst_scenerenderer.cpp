@@ -0,0 +1,110 @@
+#include "scenerenderer.h"
+#include <QtTest>
+#include <vector>
+
+namespace
+{
+    bool sameModelParameters(const SceneParameters &a, const SceneParameters &b)
+    {
+        return a.modelScale == b.modelScale && a.modelRotate == b.modelRotate && a.modelTranslate == b.modelTranslate;
+    }
+}
+
+class TestSceneRenderer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void selectionKeepsModelParameters();
+    void changesCoalesceIntoOneRecompute();
+};
+
+// Edits every instance through the state snapshots SceneWidget hands to the renderer, taking
+// the model parameters from instanceSelected() like SceneWidget does. Selecting each instance
+// again has to give back what it was left with, and SceneWidget the values it now edits.
+void TestSceneRenderer::selectionKeepsModelParameters()
+{
+    SceneRenderer scene;
+    scene.setBackend(SceneRenderer::Backend::Software);
+
+    SceneRenderer::State state = scene.state();
+    state.numOfInstances = 5;
+    scene.setState(state);
+
+    const unsigned count = scene.numOfInstances();
+    QCOMPARE(count, 5u);
+
+    SceneParameters selected = scene.parameters();
+    connect(&scene, &SceneRenderer::instanceSelected, [&selected](unsigned, const SceneParameters &parameters) {
+        selected = parameters;
+    });
+
+    std::vector<SceneParameters> expected(count);
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        // No frame in between, so edits that were not drawn yet are covered as well
+        state.selectedInstance = i;
+        scene.setState(state);
+        state.parameters = selected;
+
+        state.parameters.modelRotate.z += 10.0f;
+        state.parameters.modelTranslate.y = 0.5f * i;
+        scene.setState(state);
+        expected[i] = state.parameters;
+    }
+
+    // The last one is still selected, so every selection below is a change
+    for (unsigned index = 0; index < count; ++index)
+    {
+        state.selectedInstance = index;
+        scene.setState(state);
+        state.parameters = selected;
+
+        QVERIFY2(sameModelParameters(selected, expected[index]), qPrintable(QString("Instance %1 was selected with other model parameters").arg(index)));
+        QVERIFY2(sameModelParameters(scene.parameters(), expected[index]), qPrintable(QString("Instance %1 lost its model parameters").arg(index)));
+    }
+}
+
+// Moving a slider many times before the next frame costs that frame a single recompute of
+// the matrices, whether the changes come through the setters or through one state snapshot.
+void TestSceneRenderer::changesCoalesceIntoOneRecompute()
+{
+    SceneRenderer scene;
+    scene.setBackend(SceneRenderer::Backend::Software);
+    scene.initialize();
+    scene.resize(64, 48);
+    scene.render();
+
+    const unsigned numOfChanges = 20;
+
+    for (unsigned i = 1; i <= numOfChanges; ++i)
+        scene.setModelRotateY(2.0f * i);
+
+    scene.render();
+    QCOMPARE(scene.changesPerFrame(), numOfChanges);
+    QCOMPARE(scene.recomputesPerFrame(), 1u);
+
+    // Like SceneWidget, which counts each change it makes to the snapshot
+    SceneRenderer::State state = scene.state();
+
+    for (unsigned i = 1; i <= numOfChanges; ++i)
+    {
+        state.parameters.viewPosition.x += 0.1f;
+        ++state.numOfChanges;
+    }
+
+    scene.setState(state);
+    scene.render();
+    QCOMPARE(scene.changesPerFrame(), numOfChanges);
+    QCOMPARE(scene.recomputesPerFrame(), 1u);
+
+    // Nothing changed, nothing recomputed
+    scene.render();
+    QCOMPARE(scene.changesPerFrame(), 0u);
+    QCOMPARE(scene.recomputesPerFrame(), 0u);
+}
+
+QTEST_GUILESS_MAIN(TestSceneRenderer)
+
+#include "tst_scenerenderer.moc"